@@ -0,0 +1,144 @@
+// adversarial-events.cc
+// MIT Licenced, Copyright (c) 2024 CERN
+//
+// Synthetic worst case inputs for the clustering strategies, aimed at the
+// edge cases of tiling and of the nearest neighbour bookkeeping
+
+#include <algorithm>
+#include <cmath>
+#include <iostream>
+#include <random>
+
+#include "HepMC3/GenEvent.h"
+#include "HepMC3/GenParticle.h"
+#include "HepMC3/WriterAscii.h"
+
+#include "adversarial-events.hh"
+
+namespace {
+
+fastjet::PseudoJet massless(double pt, double rap, double phi) {
+  return fastjet::PseudoJet(pt * std::cos(phi), pt * std::sin(phi), pt * std::sinh(rap), pt * std::cosh(rap));
+}
+
+}  // namespace
+
+const std::vector<AdversarialCase>& adversarial_cases() {
+  static const std::vector<AdversarialCase> cases{
+      AdversarialCase::OneTile, AdversarialCase::CollinearBunches, AdversarialCase::PhiSeam,
+      AdversarialCase::RingAtR, AdversarialCase::DijTies,          AdversarialCase::RapiditySpread};
+  return cases;
+}
+
+const char* adversarial_case_name(AdversarialCase adversarial_case) {
+  switch (adversarial_case) {
+    case AdversarialCase::OneTile:
+      return "one-tile";
+    case AdversarialCase::CollinearBunches:
+      return "collinear-bunches";
+    case AdversarialCase::PhiSeam:
+      return "phi-seam";
+    case AdversarialCase::RingAtR:
+      return "ring-at-R";
+    case AdversarialCase::DijTies:
+      return "dij-ties";
+    case AdversarialCase::RapiditySpread:
+      return "rapidity-spread";
+  }
+  return "unknown";
+}
+
+std::vector<fastjet::PseudoJet> adversarial_event(AdversarialCase adversarial_case, size_t n, double R,
+                                                  unsigned int seed) {
+  std::mt19937 rng(seed);
+  std::uniform_real_distribution<double> unit(0.0, 1.0);
+  std::exponential_distribution<double> pt_dist(1.0);
+  auto pt = [&] { return 0.5 + pt_dist(rng); };
+
+  std::vector<fastjet::PseudoJet> particles;
+  particles.reserve(n);
+  switch (adversarial_case) {
+    case AdversarialCase::OneTile:
+      // FastJet tiles are at least R wide, so the event is a single tile
+      // (or a few, depending on the tile edges)
+      for (size_t i = 0; i < n; ++i) particles.push_back(massless(pt(), R * unit(rng), 1.0 + R * unit(rng)));
+      break;
+    case AdversarialCase::CollinearBunches: {
+      const double spread = 1.0e-4;
+      double rap = 0.0, phi = 0.0;
+      for (size_t i = 0; i < n; ++i) {
+        if (i % 16 == 0) {
+          rap = -4.0 + 8.0 * unit(rng);
+          phi = fastjet::twopi * unit(rng);
+        }
+        particles.push_back(massless(pt(), rap + spread * unit(rng), phi + spread * unit(rng)));
+      }
+      break;
+    }
+    case AdversarialCase::PhiSeam:
+      // Alternately just above 0 and just below 2pi, so nearest neighbours
+      // are always across the seam
+      for (size_t i = 0; i < n; ++i) {
+        auto dphi = 1.0e-6 * (1.0 + unit(rng));
+        particles.push_back(massless(pt(), -4.0 + 8.0 * unit(rng), i % 2 ? fastjet::twopi - dphi : dphi));
+      }
+      break;
+    case AdversarialCase::RingAtR: {
+      // A hard centre with 15 soft particles at exactly R, repeated
+      double rap = 0.0, phi = 0.0;
+      for (size_t i = 0; i < n; ++i) {
+        auto k = i % 16;
+        if (k == 0) {
+          rap = -3.0 + 6.0 * unit(rng);
+          phi = fastjet::twopi * unit(rng);
+          particles.push_back(massless(50.0 * pt(), rap, phi));
+        } else {
+          auto angle = fastjet::twopi * (k - 1) / 15.0;
+          particles.push_back(massless(pt(), rap + R * std::cos(angle), phi + R * std::sin(angle)));
+        }
+      }
+      break;
+    }
+    case AdversarialCase::DijTies: {
+      // Square lattice with spacing below R (filling |y| < 4 for large n),
+      // all with the same pt
+      auto spacing = std::min(0.7 * R, std::sqrt(8.0 * fastjet::twopi / n));
+      auto rows = size_t(fastjet::twopi / spacing);
+      for (size_t i = 0; i < n; ++i) {
+        particles.push_back(massless(1.0, -4.0 + spacing * (i / rows), 0.1 + spacing * (i % rows)));
+      }
+      break;
+    }
+    case AdversarialCase::RapiditySpread:
+      for (size_t i = 0; i < n; ++i) {
+        particles.push_back(massless(pt(), -15.0 + 30.0 * unit(rng), fastjet::twopi * unit(rng)));
+      }
+      break;
+  }
+  return particles;
+}
+
+bool write_adversarial_events(const std::string& prefix, size_t n, double R, int n_events) {
+  bool ok = true;
+  for (auto adversarial_case : adversarial_cases()) {
+    auto filename = prefix + adversarial_case_name(adversarial_case) + ".hepmc3";
+    HepMC3::WriterAscii writer(filename);
+    for (int ievt = 0; ievt < n_events; ++ievt) {
+      HepMC3::GenEvent evt(HepMC3::Units::GEV, HepMC3::Units::MM);
+      evt.set_event_number(ievt);
+      for (const auto& p : adversarial_event(adversarial_case, n, R, ievt + 1)) {
+        evt.add_particle(std::make_shared<HepMC3::GenParticle>(HepMC3::FourVector(p.px(), p.py(), p.pz(), p.E()),
+                                                               211, 1));
+      }
+      writer.write_event(evt);
+    }
+    writer.close();
+    if (writer.failed()) {
+      std::cerr << "Failed to write " << filename << std::endl;
+      ok = false;
+    } else {
+      std::cout << "Wrote " << n_events << " events to " << filename << std::endl;
+    }
+  }
+  return ok;
+}
@@ -0,0 +1,37 @@
+// adversarial-events.hh
+// MIT Licenced, Copyright (c) 2024 CERN
+//
+// Synthetic worst case inputs for the clustering strategies, aimed at the
+// edge cases of tiling and of the nearest neighbour bookkeeping
+
+#ifndef ADVERSARIAL_EVENTS_HH
+#define ADVERSARIAL_EVENTS_HH
+
+#include <string>
+#include <vector>
+
+#include "fastjet/PseudoJet.hh"
+
+enum class AdversarialCase {
+  OneTile,           // every particle inside one R x R tile
+  CollinearBunches,  // bunches of 16 particles within 1e-4 of each other
+  PhiSeam,           // particles either side of the phi = 0 / 2pi seam
+  RingAtR,           // rings of particles exactly R from a hard centre
+  DijTies,           // identical pt on a regular lattice, so d_ij tie
+  RapiditySpread,    // rapidities spread over |y| < 15
+};
+
+const std::vector<AdversarialCase>& adversarial_cases();
+
+const char* adversarial_case_name(AdversarialCase adversarial_case);
+
+// n massless particles for the case, for a jet radius R; the same seed
+// gives the same event
+std::vector<fastjet::PseudoJet> adversarial_event(AdversarialCase adversarial_case, size_t n, double R,
+                                                  unsigned int seed = 1);
+
+// Write n_events events of n particles for each case, for a jet radius R,
+// to prefix + "<case>.hepmc3"; returns false if any file failed
+bool write_adversarial_events(const std::string& prefix, size_t n, double R, int n_events);
+
+#endif
@@ -0,0 +1,205 @@
+// arrow-output.cc
+// MIT Licenced, Copyright (c) 2024 CERN
+//
+// Columnar output of selected jets as an Apache Arrow IPC stream
+
+#include <condition_variable>
+#include <deque>
+#include <iostream>
+#include <mutex>
+#include <thread>
+
+#include <arrow/api.h>
+#include <arrow/io/file.h>
+#include <arrow/ipc/writer.h>
+
+#include "arrow-output.hh"
+
+namespace {
+
+// Column data for one record batch, filled by the event loop
+struct JetBatch {
+  std::vector<uint32_t> event;
+  std::vector<uint32_t> jet;
+  std::vector<double> px, py, pz, E, rap, phi, pt;
+  std::vector<int32_t> n_constituents;
+  std::vector<int32_t> constituent_offsets{0};
+  std::vector<int32_t> constituents;
+
+  size_t size() const { return event.size(); }
+};
+
+std::shared_ptr<arrow::Schema> jet_schema(bool with_constituents) {
+  arrow::FieldVector fields{
+      arrow::field("event", arrow::uint32(), false),
+      arrow::field("jet", arrow::uint32(), false),
+      arrow::field("px", arrow::float64(), false),
+      arrow::field("py", arrow::float64(), false),
+      arrow::field("pz", arrow::float64(), false),
+      arrow::field("E", arrow::float64(), false),
+      arrow::field("rap", arrow::float64(), false),
+      arrow::field("phi", arrow::float64(), false),
+      arrow::field("pt", arrow::float64(), false),
+      arrow::field("n_constituents", arrow::int32(), false),
+  };
+  if (with_constituents) {
+    fields.push_back(arrow::field("constituents", arrow::list(arrow::int32()), false));
+  }
+  return arrow::schema(fields);
+}
+
+template <typename Builder, typename T>
+arrow::Result<std::shared_ptr<arrow::Array>> make_array(const std::vector<T>& values) {
+  Builder builder;
+  ARROW_RETURN_NOT_OK(builder.AppendValues(values));
+  return builder.Finish();
+}
+
+arrow::Result<std::shared_ptr<arrow::RecordBatch>> make_record_batch(
+    const std::shared_ptr<arrow::Schema>& schema, const JetBatch& batch, bool with_constituents) {
+  arrow::ArrayVector columns;
+  ARROW_ASSIGN_OR_RAISE(auto event, make_array<arrow::UInt32Builder>(batch.event));
+  ARROW_ASSIGN_OR_RAISE(auto jet, make_array<arrow::UInt32Builder>(batch.jet));
+  ARROW_ASSIGN_OR_RAISE(auto px, make_array<arrow::DoubleBuilder>(batch.px));
+  ARROW_ASSIGN_OR_RAISE(auto py, make_array<arrow::DoubleBuilder>(batch.py));
+  ARROW_ASSIGN_OR_RAISE(auto pz, make_array<arrow::DoubleBuilder>(batch.pz));
+  ARROW_ASSIGN_OR_RAISE(auto E, make_array<arrow::DoubleBuilder>(batch.E));
+  ARROW_ASSIGN_OR_RAISE(auto rap, make_array<arrow::DoubleBuilder>(batch.rap));
+  ARROW_ASSIGN_OR_RAISE(auto phi, make_array<arrow::DoubleBuilder>(batch.phi));
+  ARROW_ASSIGN_OR_RAISE(auto pt, make_array<arrow::DoubleBuilder>(batch.pt));
+  ARROW_ASSIGN_OR_RAISE(auto n_constituents, make_array<arrow::Int32Builder>(batch.n_constituents));
+  columns = {event, jet, px, py, pz, E, rap, phi, pt, n_constituents};
+  if (with_constituents) {
+    ARROW_ASSIGN_OR_RAISE(auto offsets, make_array<arrow::Int32Builder>(batch.constituent_offsets));
+    ARROW_ASSIGN_OR_RAISE(auto values, make_array<arrow::Int32Builder>(batch.constituents));
+    ARROW_ASSIGN_OR_RAISE(auto constituents, arrow::ListArray::FromArrays(*offsets, *values));
+    columns.push_back(constituents);
+  }
+  return arrow::RecordBatch::Make(schema, batch.size(), columns);
+}
+
+}  // namespace
+
+struct ArrowJetWriter::Impl {
+  std::string filename;
+  bool with_constituents;
+  size_t batch_rows;
+  std::shared_ptr<arrow::Schema> schema;
+  std::shared_ptr<arrow::io::FileOutputStream> sink;
+  std::shared_ptr<arrow::ipc::RecordBatchWriter> writer;
+
+  JetBatch current;
+  std::deque<JetBatch> queue;
+  std::mutex mutex;
+  std::condition_variable cv;
+  bool finished = false;
+  bool ok = true;
+  size_t rows = 0;
+  std::thread thread;
+
+  void submit() {
+    if (current.size() == 0) return;
+    {
+      std::lock_guard<std::mutex> lock(mutex);
+      queue.push_back(std::move(current));
+    }
+    cv.notify_one();
+    current = JetBatch{};
+  }
+
+  void write_loop() {
+    while (true) {
+      JetBatch batch;
+      {
+        std::unique_lock<std::mutex> lock(mutex);
+        cv.wait(lock, [this] { return finished || !queue.empty(); });
+        if (queue.empty()) return;
+        batch = std::move(queue.front());
+        queue.pop_front();
+      }
+      if (!ok) continue;
+      auto status = write_batch(batch);
+      if (!status.ok()) {
+        std::cerr << "Error writing Arrow output to " << filename << ": " << status.ToString() << std::endl;
+        ok = false;
+      }
+    }
+  }
+
+  arrow::Status write_batch(const JetBatch& batch) {
+    ARROW_ASSIGN_OR_RAISE(auto record_batch, make_record_batch(schema, batch, with_constituents));
+    ARROW_RETURN_NOT_OK(writer->WriteRecordBatch(*record_batch));
+    rows += batch.size();
+    return arrow::Status::OK();
+  }
+
+  arrow::Status open() {
+    ARROW_ASSIGN_OR_RAISE(sink, arrow::io::FileOutputStream::Open(filename));
+    ARROW_ASSIGN_OR_RAISE(writer, arrow::ipc::MakeStreamWriter(sink, schema));
+    return arrow::Status::OK();
+  }
+};
+
+ArrowJetWriter::ArrowJetWriter(const std::string& filename, bool with_constituents, size_t batch_rows)
+    : m_impl(new Impl) {
+  m_impl->filename = filename;
+  m_impl->with_constituents = with_constituents;
+  m_impl->batch_rows = batch_rows > 0 ? batch_rows : 1;
+  m_impl->schema = jet_schema(with_constituents);
+  auto status = m_impl->open();
+  if (!status.ok()) {
+    std::cerr << "Failed to open Arrow output " << filename << ": " << status.ToString() << std::endl;
+    m_impl->ok = false;
+    m_impl->writer.reset();
+    return;
+  }
+  m_impl->thread = std::thread([this] { m_impl->write_loop(); });
+}
+
+ArrowJetWriter::~ArrowJetWriter() { close(); }
+
+void ArrowJetWriter::add_event(size_t event, const std::vector<fastjet::PseudoJet>& jets,
+                               const JetConstituents& constituents) {
+  auto& batch = m_impl->current;
+  for (size_t ijet = 0; ijet < jets.size(); ++ijet) {
+    const auto& jet = jets[ijet];
+    batch.event.push_back(event);
+    batch.jet.push_back(ijet);
+    batch.px.push_back(jet.px());
+    batch.py.push_back(jet.py());
+    batch.pz.push_back(jet.pz());
+    batch.E.push_back(jet.E());
+    batch.rap.push_back(jet.rap());
+    batch.phi.push_back(jet.phi());
+    batch.pt.push_back(jet.perp());
+    batch.n_constituents.push_back(constituents.size(ijet));
+    if (m_impl->with_constituents) {
+      batch.constituents.insert(batch.constituents.end(), constituents.begin(ijet), constituents.end(ijet));
+    }
+    batch.constituent_offsets.push_back(batch.constituents.size());
+  }
+  if (batch.size() >= m_impl->batch_rows) m_impl->submit();
+}
+
+bool ArrowJetWriter::close() {
+  if (!m_impl->thread.joinable()) return m_impl->ok;
+  m_impl->submit();
+  {
+    std::lock_guard<std::mutex> lock(m_impl->mutex);
+    m_impl->finished = true;
+  }
+  m_impl->cv.notify_one();
+  m_impl->thread.join();
+
+  auto status = m_impl->writer->Close();
+  if (status.ok()) status = m_impl->sink->Close();
+  if (!status.ok()) {
+    std::cerr << "Error closing Arrow output " << m_impl->filename << ": " << status.ToString() << std::endl;
+    m_impl->ok = false;
+  }
+  return m_impl->ok;
+}
+
+bool ArrowJetWriter::is_open() const { return m_impl->writer != nullptr; }
+
+size_t ArrowJetWriter::rows_written() const { return m_impl->rows; }
@@ -0,0 +1,52 @@
+// arrow-output.hh
+// MIT Licenced, Copyright (c) 2024 CERN
+//
+// Columnar output of selected jets as an Apache Arrow IPC stream,
+// which can be read directly by Arrow.jl, pyarrow and ROOT's RDataFrame
+
+#ifndef ARROW_OUTPUT_HH
+#define ARROW_OUTPUT_HH
+
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "fastjet/PseudoJet.hh"
+
+#include "constituent-index.hh"
+
+// Jets are accumulated in plain column vectors by the event loop; full
+// batches are handed over to a background thread that converts them to
+// Arrow record batches and writes them to the stream, so that the cost of
+// serialisation is kept out of the event loop
+class ArrowJetWriter {
+public:
+  ArrowJetWriter(const std::string& filename, bool with_constituents = false,
+                 size_t batch_rows = 65536);
+  ~ArrowJetWriter();
+
+  ArrowJetWriter(const ArrowJetWriter&) = delete;
+  ArrowJetWriter& operator=(const ArrowJetWriter&) = delete;
+
+  // False if the output stream could not be opened
+  bool is_open() const;
+
+  // Add the jets of one event, with their constituent index; event numbers
+  // are counted from 1, as in the text dump, and jets from 0 in the order
+  // given
+  void add_event(size_t event, const std::vector<fastjet::PseudoJet>& jets,
+                 const JetConstituents& constituents);
+
+  // Flush the last partial batch, wait for the writer thread and close the
+  // stream; returns false if any write failed
+  bool close();
+
+  size_t rows_written() const;
+
+private:
+  struct Impl;
+  std::unique_ptr<Impl> m_impl;
+};
+
+#endif
@@ -0,0 +1,370 @@
+// async-input.cc
+// MIT Licenced, Copyright (c) 2024 CERN
+//
+// Input stream buffer that keeps several large reads of the input file in
+// flight, so that parsing of streamed events does not stall on I/O
+
+#include <algorithm>
+#include <cerrno>
+#include <chrono>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <vector>
+
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#if defined(__linux__) && __has_include(<linux/io_uring.h>)
+#include <linux/io_uring.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#define ASYNC_INPUT_HAVE_IO_URING 1
+#endif
+
+#include "async-input.hh"
+
+using namespace std;
+
+namespace {
+
+constexpr size_t kAlignment = 4096;
+constexpr long kPending = -1;
+
+#ifdef ASYNC_INPUT_HAVE_IO_URING
+// Minimal io_uring submission and completion rings over the raw kernel
+// interface (so there is no dependency on liburing), covering only what is
+// needed to queue file reads
+class ReadRing {
+public:
+  explicit ReadRing(unsigned entries) {
+    io_uring_params params;
+    std::memset(&params, 0, sizeof(params));
+    m_fd = syscall(__NR_io_uring_setup, entries, &params);
+    if (m_fd < 0) return;
+
+    m_sq_size = params.sq_off.array + params.sq_entries * sizeof(unsigned);
+    m_cq_size = params.cq_off.cqes + params.cq_entries * sizeof(io_uring_cqe);
+    const bool single_mmap = params.features & IORING_FEAT_SINGLE_MMAP;
+    if (single_mmap) m_sq_size = m_cq_size = std::max(m_sq_size, m_cq_size);
+
+    m_sq_ptr = mmap(nullptr, m_sq_size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, m_fd,
+                    IORING_OFF_SQ_RING);
+    m_cq_ptr = single_mmap ? m_sq_ptr
+                           : mmap(nullptr, m_cq_size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE,
+                                  m_fd, IORING_OFF_CQ_RING);
+    m_sqes_size = params.sq_entries * sizeof(io_uring_sqe);
+    m_sqes_ptr = mmap(nullptr, m_sqes_size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, m_fd,
+                      IORING_OFF_SQES);
+    if (m_sq_ptr == MAP_FAILED || m_cq_ptr == MAP_FAILED || m_sqes_ptr == MAP_FAILED) {
+      release();
+      return;
+    }
+
+    auto sq = static_cast<char*>(m_sq_ptr);
+    m_sq_tail = reinterpret_cast<unsigned*>(sq + params.sq_off.tail);
+    m_sq_mask = reinterpret_cast<unsigned*>(sq + params.sq_off.ring_mask);
+    m_sq_array = reinterpret_cast<unsigned*>(sq + params.sq_off.array);
+    auto cq = static_cast<char*>(m_cq_ptr);
+    m_cq_head = reinterpret_cast<unsigned*>(cq + params.cq_off.head);
+    m_cq_tail = reinterpret_cast<unsigned*>(cq + params.cq_off.tail);
+    m_cq_mask = reinterpret_cast<unsigned*>(cq + params.cq_off.ring_mask);
+    m_cqes = reinterpret_cast<io_uring_cqe*>(cq + params.cq_off.cqes);
+    m_sqes = static_cast<io_uring_sqe*>(m_sqes_ptr);
+  }
+
+  ~ReadRing() { release(); }
+
+  bool ok() const { return m_fd >= 0; }
+
+  // Queue and submit one read; false if it was not submitted. The tail is
+  // published before io_uring_enter, so after a failed enter the entry
+  // stays queued and would be submitted by the next one, into a buffer that
+  // may have been reused: the ring is then not used for any more reads.
+  bool submit_read(int fd, void* buffer, unsigned len, uint64_t offset, uint64_t user_data) {
+    if (m_failed) return false;
+    // Only this thread writes the submission tail
+    auto tail = *m_sq_tail;
+    auto index = tail & *m_sq_mask;
+    auto& sqe = m_sqes[index];
+    std::memset(&sqe, 0, sizeof(sqe));
+    sqe.opcode = IORING_OP_READ;
+    sqe.fd = fd;
+    sqe.addr = reinterpret_cast<uint64_t>(buffer);
+    sqe.len = len;
+    sqe.off = offset;
+    sqe.user_data = user_data;
+    m_sq_array[index] = index;
+    __atomic_store_n(m_sq_tail, tail + 1, __ATOMIC_RELEASE);
+    int ret;
+    do {
+      ret = syscall(__NR_io_uring_enter, m_fd, 1, 0, 0, nullptr, 0);
+    } while (ret < 0 && errno == EINTR);
+    if (ret != 1) m_failed = true;
+    return ret == 1;
+  }
+
+  // Pop one completion if there is one ready
+  bool pop_completion(uint64_t& user_data, int& res) {
+    auto head = *m_cq_head;
+    if (head == __atomic_load_n(m_cq_tail, __ATOMIC_ACQUIRE)) return false;
+    const auto& cqe = m_cqes[head & *m_cq_mask];
+    user_data = cqe.user_data;
+    res = cqe.res;
+    __atomic_store_n(m_cq_head, head + 1, __ATOMIC_RELEASE);
+    return true;
+  }
+
+  // Pop one completion, waiting for it if needed; false on error
+  bool wait_completion(uint64_t& user_data, int& res) {
+    while (true) {
+      if (pop_completion(user_data, res)) return true;
+      auto ret = syscall(__NR_io_uring_enter, m_fd, 0, 1, IORING_ENTER_GETEVENTS, nullptr, 0);
+      if (ret < 0 && errno != EINTR) return false;
+    }
+  }
+
+private:
+  void release() {
+    if (m_sqes_ptr != MAP_FAILED) munmap(m_sqes_ptr, m_sqes_size);
+    if (m_cq_ptr != MAP_FAILED && m_cq_ptr != m_sq_ptr) munmap(m_cq_ptr, m_cq_size);
+    if (m_sq_ptr != MAP_FAILED) munmap(m_sq_ptr, m_sq_size);
+    m_sqes_ptr = m_cq_ptr = m_sq_ptr = MAP_FAILED;
+    if (m_fd >= 0) close(m_fd);
+    m_fd = -1;
+  }
+
+  int m_fd = -1;
+  bool m_failed = false;
+  void* m_sq_ptr = MAP_FAILED;
+  void* m_cq_ptr = MAP_FAILED;
+  void* m_sqes_ptr = MAP_FAILED;
+  size_t m_sq_size = 0, m_cq_size = 0, m_sqes_size = 0;
+  unsigned *m_sq_tail = nullptr, *m_sq_mask = nullptr, *m_sq_array = nullptr;
+  unsigned *m_cq_head = nullptr, *m_cq_tail = nullptr, *m_cq_mask = nullptr;
+  io_uring_sqe* m_sqes = nullptr;
+  io_uring_cqe* m_cqes = nullptr;
+};
+#else
+// Placeholder when io_uring is not available at build time
+class ReadRing {
+public:
+  explicit ReadRing(unsigned) {}
+  bool ok() const { return false; }
+  bool submit_read(int, void*, unsigned, uint64_t, uint64_t) { return false; }
+  bool pop_completion(uint64_t&, int&) { return false; }
+  bool wait_completion(uint64_t&, int&) { return false; }
+};
+#endif
+
+// Blocking read of len bytes at offset, retrying short reads; returns the
+// number of bytes read or -1 on error. Reads may ask for up to request
+// bytes (for O_DIRECT, where the size must be aligned even at end of file).
+long pread_full(int fd, char* buffer, size_t len, size_t offset, size_t request = 0) {
+  size_t done = 0;
+  while (done < len) {
+    auto n = pread(fd, buffer + done, std::max(len, request) - done, offset + done);
+    if (n < 0 && errno == EINTR) continue;
+    if (n < 0) return -1;
+    if (n == 0) break;
+    done += n;
+  }
+  return done;
+}
+
+}  // namespace
+
+const char* backend_name(AsyncReadBackend backend) {
+  return backend == AsyncReadBackend::IoUring ? "io_uring" : "pread";
+}
+
+struct AsyncFileBuf::Impl {
+  int fd = -1;
+  size_t file_size = 0;
+  size_t block_size;
+  unsigned depth;
+  size_t n_blocks = 0;
+  AsyncReadBackend backend;
+  bool direct = false;
+  std::unique_ptr<ReadRing> ring;
+
+  char* storage = nullptr;
+  std::vector<long> slot_bytes;  // bytes read into each buffer, or kPending
+  size_t next_submit = 0;        // next block to queue
+  size_t next_consume = 0;       // next block for the parser
+  unsigned in_flight = 0;
+  bool consuming = false;
+  AsyncReadStats stats;
+
+  char* buffer(size_t block) { return storage + (block % depth) * block_size; }
+  size_t block_length(size_t block) const {
+    return std::min(block_size, file_size - block * block_size);
+  }
+  // O_DIRECT reads must be a multiple of the alignment
+  size_t request_length(size_t block) const {
+    auto len = block_length(block);
+    return direct ? (len + kAlignment - 1) / kAlignment * kAlignment : len;
+  }
+  long read_block(size_t block) {
+    return pread_full(fd, buffer(block), block_length(block), block * block_size, request_length(block));
+  }
+
+  void submit(size_t block) {
+    auto slot = block % depth;
+    slot_bytes[slot] = kPending;
+    ++stats.reads;
+    if (ring->submit_read(fd, buffer(block), request_length(block), block * block_size, block)) {
+      ++in_flight;
+      stats.max_depth = std::max(stats.max_depth, in_flight);
+    } else {
+      slot_bytes[slot] = read_block(block);
+    }
+  }
+
+  // Wait until the given block is read; returns its length or -1
+  long wait_for(size_t block) {
+    using clock = std::chrono::steady_clock;
+    const auto slot = block % depth;
+    const auto expected = long(block_length(block));
+    ++stats.waits;
+    stats.depth_sum += in_flight;
+
+    long n;
+    if (backend == AsyncReadBackend::Pread) {
+      auto start_t = clock::now();
+      ++stats.reads;
+      n = read_block(block);
+      stats.stall_us += std::chrono::duration<double, std::micro>(clock::now() - start_t).count();
+      ++stats.stalls;
+      return n;
+    }
+
+    // Collect reads that have already completed
+    uint64_t done_block;
+    int res;
+    while (ring->pop_completion(done_block, res)) {
+      --in_flight;
+      slot_bytes[done_block % depth] = res;
+    }
+    if (slot_bytes[slot] == kPending) {
+      ++stats.stalls;
+      auto start_t = clock::now();
+      while (slot_bytes[slot] == kPending) {
+        if (!ring->wait_completion(done_block, res)) return -1;
+        --in_flight;
+        slot_bytes[done_block % depth] = res;
+      }
+      stats.stall_us += std::chrono::duration<double, std::micro>(clock::now() - start_t).count();
+    }
+    n = slot_bytes[slot];
+    if (n < 0 || (direct && n < expected)) {
+      // Failed asynchronous read (e.g., an old kernel without
+      // IORING_OP_READ), so read the block directly
+      n = read_block(block);
+    } else if (n < expected) {
+      auto rest = pread_full(fd, buffer(block) + n, expected - n, block * block_size + n);
+      n = rest < 0 ? -1 : n + rest;
+    }
+    return n;
+  }
+
+  void drain() {
+    while (ring && in_flight > 0) {
+      uint64_t done_block;
+      int res;
+      if (!ring->wait_completion(done_block, res)) break;
+      --in_flight;
+    }
+  }
+};
+
+AsyncFileBuf::AsyncFileBuf(const std::string& filename, AsyncReadBackend backend, size_t block_size,
+                           unsigned depth, bool direct)
+    : m_impl(new Impl) {
+  auto& impl = *m_impl;
+  impl.block_size = std::max((block_size + kAlignment - 1) / kAlignment, size_t(1)) * kAlignment;
+  impl.depth = std::max(depth, 1u);
+  impl.backend = backend;
+
+  if (direct) {
+    impl.fd = open(filename.c_str(), O_RDONLY | O_DIRECT);
+    impl.direct = impl.fd >= 0;
+    if (!impl.direct) {
+      cerr << "O_DIRECT reads not supported for " << filename << " (" << strerror(errno) <<
+        "), reading through the page cache" << endl;
+    }
+  }
+  if (!impl.direct) impl.fd = open(filename.c_str(), O_RDONLY);
+  struct stat st;
+  if (impl.fd < 0 || fstat(impl.fd, &st) != 0) {
+    cerr << "Failed to open " << filename << ": " << strerror(errno) << endl;
+    if (impl.fd >= 0) close(impl.fd);
+    impl.fd = -1;
+    return;
+  }
+  impl.file_size = st.st_size;
+  impl.n_blocks = (impl.file_size + impl.block_size - 1) / impl.block_size;
+
+  if (posix_memalign(reinterpret_cast<void**>(&impl.storage), kAlignment, impl.depth * impl.block_size) != 0) {
+    cerr << "Failed to allocate input buffers for " << filename << endl;
+    close(impl.fd);
+    impl.fd = -1;
+    impl.storage = nullptr;
+    return;
+  }
+  impl.slot_bytes.assign(impl.depth, kPending);
+
+  if (impl.backend == AsyncReadBackend::IoUring) {
+    impl.ring.reset(new ReadRing(impl.depth));
+    if (!impl.ring->ok()) {
+      impl.ring.reset();
+      impl.backend = AsyncReadBackend::Pread;
+    }
+  }
+  if (impl.backend == AsyncReadBackend::IoUring) {
+    while (impl.next_submit < std::min<size_t>(impl.depth, impl.n_blocks)) impl.submit(impl.next_submit++);
+  }
+}
+
+AsyncFileBuf::~AsyncFileBuf() {
+  // Outstanding reads must complete before their buffers are freed
+  m_impl->drain();
+  m_impl->ring.reset();
+  if (m_impl->fd >= 0) close(m_impl->fd);
+  free(m_impl->storage);
+}
+
+bool AsyncFileBuf::is_open() const { return m_impl->fd >= 0; }
+
+AsyncReadBackend AsyncFileBuf::backend() const { return m_impl->backend; }
+
+bool AsyncFileBuf::direct() const { return m_impl->direct; }
+
+const AsyncReadStats& AsyncFileBuf::stats() const { return m_impl->stats; }
+
+AsyncFileBuf::int_type AsyncFileBuf::underflow() {
+  if (gptr() < egptr()) return traits_type::to_int_type(*gptr());
+  auto& impl = *m_impl;
+  if (impl.fd < 0) return traits_type::eof();
+
+  // The buffer just consumed is free for the next unread block
+  if (impl.consuming && impl.backend == AsyncReadBackend::IoUring && impl.next_submit < impl.n_blocks) {
+    impl.submit(impl.next_submit++);
+  }
+  impl.consuming = false;
+  if (impl.next_consume >= impl.n_blocks) return traits_type::eof();
+
+  auto block = impl.next_consume++;
+  auto n = impl.wait_for(block);
+  if (n <= 0) {
+    if (n < 0) cerr << "Read error on input file: " << strerror(errno) << endl;
+    return traits_type::eof();
+  }
+  impl.consuming = true;
+  impl.stats.bytes += n;
+  auto data = impl.buffer(block);
+  setg(data, data, data + n);
+  return traits_type::to_int_type(*gptr());
+}
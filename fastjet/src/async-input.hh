@@ -0,0 +1,66 @@
+// async-input.hh
+// MIT Licenced, Copyright (c) 2024 CERN
+//
+// Input stream buffer that keeps several large reads of the input file in
+// flight, so that parsing of streamed events does not stall on I/O
+
+#ifndef ASYNC_INPUT_HH
+#define ASYNC_INPUT_HH
+
+#include <memory>
+#include <streambuf>
+#include <string>
+
+enum class AsyncReadBackend { IoUring, Pread };
+
+const char* backend_name(AsyncReadBackend backend);
+
+struct AsyncReadStats {
+  size_t bytes = 0;         // bytes delivered to the parser
+  size_t reads = 0;         // read requests issued
+  size_t waits = 0;         // times the parser needed a new block
+  size_t stalls = 0;        // ...and the block was not yet read
+  double stall_us = 0.0;    // total time the parser waited for reads
+  size_t depth_sum = 0;     // sum over waits of the reads in flight
+  unsigned max_depth = 0;   // maximum reads in flight
+  double mean_depth() const { return waits ? double(depth_sum) / waits : 0.0; }
+};
+
+// The file is read in blocks of block_size bytes into a ring of depth
+// buffers. With the io_uring backend up to depth reads are queued ahead of
+// the parser, and a buffer is resubmitted for the next unread block as soon
+// as the parser has consumed it. If io_uring is not available at build or
+// run time (e.g., blocked by a container's seccomp profile) each block is
+// read with a blocking pread when the parser needs it.
+//
+// With direct, the file is opened with O_DIRECT, so reads bypass (and do
+// not populate) the page cache; if the file system does not support this,
+// the file is read normally.
+class AsyncFileBuf : public std::streambuf {
+public:
+  AsyncFileBuf(const std::string& filename, AsyncReadBackend backend = AsyncReadBackend::IoUring,
+               size_t block_size = 1 << 20, unsigned depth = 4, bool direct = false);
+  ~AsyncFileBuf();
+
+  AsyncFileBuf(const AsyncFileBuf&) = delete;
+  AsyncFileBuf& operator=(const AsyncFileBuf&) = delete;
+
+  bool is_open() const;
+
+  // Backend actually in use, after any fallback
+  AsyncReadBackend backend() const;
+
+  // True if reads bypass the page cache
+  bool direct() const;
+
+  const AsyncReadStats& stats() const;
+
+protected:
+  int_type underflow() override;
+
+private:
+  struct Impl;
+  std::unique_ptr<Impl> m_impl;
+};
+
+#endif
@@ -0,0 +1,40 @@
+// constituent-index.cc
+// MIT Licenced, Copyright (c) 2024 CERN
+//
+// Flat arrays of the constituent particle indexes of the final jets of an
+// event, as an alternative to PseudoJet::constituents()
+
+#include "constituent-index.hh"
+
+void build_jet_constituents(const fastjet::ClusterSequence& cs, const std::vector<fastjet::PseudoJet>& jets,
+                            JetConstituents& constituents) {
+  const auto& history = cs.history();
+  const int n_particles = cs.n_particles();
+
+  // Owning jet of each history entry (-1 for none), propagated from
+  // children to parents; parents always precede their children
+  thread_local std::vector<int> owner;
+  owner.assign(history.size(), -1);
+  for (size_t ijet = 0; ijet < jets.size(); ++ijet) owner[jets[ijet].cluster_hist_index()] = ijet;
+  for (auto h = int(history.size()) - 1; h >= n_particles; --h) {
+    if (owner[h] < 0) continue;
+    const auto& entry = history[h];
+    if (entry.parent1 >= 0) owner[entry.parent1] = owner[h];
+    if (entry.parent2 >= 0) owner[entry.parent2] = owner[h];
+  }
+
+  // Counting sort of the particles by owning jet
+  auto& offsets = constituents.offsets;
+  auto& indices = constituents.indices;
+  offsets.assign(jets.size() + 1, 0);
+  for (int i = 0; i < n_particles; ++i) {
+    if (owner[i] >= 0) ++offsets[owner[i] + 1];
+  }
+  for (size_t ijet = 0; ijet < jets.size(); ++ijet) offsets[ijet + 1] += offsets[ijet];
+  indices.resize(offsets.back());
+  thread_local std::vector<int> fill;
+  fill.assign(offsets.begin(), offsets.end() - 1);
+  for (int i = 0; i < n_particles; ++i) {
+    if (owner[i] >= 0) indices[fill[owner[i]]++] = i;
+  }
+}
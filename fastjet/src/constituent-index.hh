@@ -0,0 +1,38 @@
+// constituent-index.hh
+// MIT Licenced, Copyright (c) 2024 CERN
+//
+// Flat arrays of the constituent particle indexes of the final jets of an
+// event, as an alternative to PseudoJet::constituents()
+
+#ifndef CONSTITUENT_INDEX_HH
+#define CONSTITUENT_INDEX_HH
+
+#include <vector>
+
+#include "fastjet/ClusterSequence.hh"
+#include "fastjet/PseudoJet.hh"
+
+// Input particle indexes (counted from 0, in the order given to the
+// cluster sequence) of each jet's constituents, grouped by jet, with
+// offsets; the constituents of jet i are indices[offsets[i]] up to
+// indices[offsets[i + 1]], in increasing order
+struct JetConstituents {
+  std::vector<int> offsets{0};
+  std::vector<int> indices;
+
+  size_t n_jets() const { return offsets.size() - 1; }
+  size_t size(size_t ijet) const { return offsets[ijet + 1] - offsets[ijet]; }
+  const int* begin(size_t ijet) const { return indices.data() + offsets[ijet]; }
+  const int* end(size_t ijet) const { return indices.data() + offsets[ijet + 1]; }
+};
+
+// Fill constituents for the given jets (which must come from cs) with a
+// single backwards pass over the clustering history, where each history
+// entry passes its owning jet on to its parents, so the cost does not
+// depend on the number of jets; storage in constituents is reused.
+// Initial particles occupy the first history entries, so their history
+// index is their index in the input.
+void build_jet_constituents(const fastjet::ClusterSequence& cs, const std::vector<fastjet::PseudoJet>& jets,
+                            JetConstituents& constituents);
+
+#endif
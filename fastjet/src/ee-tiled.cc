@@ -0,0 +1,420 @@
+// ee-tiled.cc
+// MIT Licenced, Copyright (c) 2024 CERN
+//
+// Tiled clustering for the e+e- generalised kt algorithm, as a FastJet
+// plugin, where the tiles are cells on the unit sphere
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <iostream>
+#include <sstream>
+#include <stdexcept>
+
+#include "ee-tiled.hh"
+
+namespace {
+
+// More tiles than this per cube edge (i.e., 6 x 24 x 24 tiles) would make
+// the neighbour search at construction slow, and gain little for the
+// multiplicities of e+e- events
+constexpr int kMaxTilesPerEdge = 24;
+
+struct Direction {
+  double x, y, z;
+};
+
+Direction normalised(double x, double y, double z) {
+  auto norm = std::sqrt(x * x + y * y + z * z);
+  return {x / norm, y / norm, z / norm};
+}
+
+double angle(const Direction& a, const Direction& b) {
+  return std::acos(std::clamp(a.x * b.x + a.y * b.y + a.z * b.z, -1.0, 1.0));
+}
+
+// Point on the sphere for face coordinates a, b in [-1, 1], which are
+// angles (in units of pi/4) on the cube face, so cells are about equal in
+// angular size
+Direction face_direction(int face, double a, double b) {
+  auto u = std::tan(a * fastjet::pi / 4);
+  auto v = std::tan(b * fastjet::pi / 4);
+  switch (face) {
+    case 0: return normalised(1.0, u, v);
+    case 1: return normalised(-1.0, u, v);
+    case 2: return normalised(u, 1.0, v);
+    case 3: return normalised(u, -1.0, v);
+    case 4: return normalised(u, v, 1.0);
+    default: return normalised(u, v, -1.0);
+  }
+}
+
+// Binary min-heap of the distance of each slot, with the position of each
+// slot in the heap so that its key can be changed
+class IndexedMinHeap {
+public:
+  explicit IndexedMinHeap(const std::vector<double>& keys) : m_key(keys), m_heap(keys.size()), m_pos(keys.size()) {
+    for (size_t i = 0; i < m_heap.size(); ++i) m_heap[i] = m_pos[i] = i;
+    for (auto i = int(m_heap.size()) / 2 - 1; i >= 0; --i) sift_down(i);
+  }
+
+  int top() const { return m_heap.front(); }
+  double top_key() const { return m_key[m_heap.front()]; }
+
+  void update(int slot, double key) {
+    auto old_key = m_key[slot];
+    m_key[slot] = key;
+    if (less(slot, old_key)) {
+      sift_up(m_pos[slot]);
+    } else {
+      sift_down(m_pos[slot]);
+    }
+  }
+
+  void remove(int slot) {
+    auto i = m_pos[slot];
+    auto last = m_heap.back();
+    m_heap.pop_back();
+    if (last == slot) return;
+    m_heap[i] = last;
+    m_pos[last] = i;
+    sift_up(i);
+    sift_down(m_pos[last]);
+  }
+
+private:
+  // Ties are broken by slot, for reproducibility
+  bool before(int a, int b) const { return m_key[a] < m_key[b] || (m_key[a] == m_key[b] && a < b); }
+  bool less(int slot, double key) const { return m_key[slot] < key; }
+
+  void swap(int i, int j) {
+    std::swap(m_heap[i], m_heap[j]);
+    m_pos[m_heap[i]] = i;
+    m_pos[m_heap[j]] = j;
+  }
+
+  void sift_up(int i) {
+    while (i > 0) {
+      auto parent = (i - 1) / 2;
+      if (!before(m_heap[i], m_heap[parent])) break;
+      swap(i, parent);
+      i = parent;
+    }
+  }
+
+  void sift_down(int i) {
+    const int n = m_heap.size();
+    while (true) {
+      auto smallest = i;
+      auto left = 2 * i + 1, right = 2 * i + 2;
+      if (left < n && before(m_heap[left], m_heap[smallest])) smallest = left;
+      if (right < n && before(m_heap[right], m_heap[smallest])) smallest = right;
+      if (smallest == i) break;
+      swap(i, smallest);
+      i = smallest;
+    }
+  }
+
+  std::vector<double> m_key;
+  std::vector<int> m_heap;
+  std::vector<int> m_pos;
+};
+
+struct TiledJet {
+  double nx, ny, nz;  // direction
+  double f;           // E^2p
+  int jet_index;      // index in the cluster sequence, -1 once finished
+  int tile;
+  int nn;             // nearest neighbour slot, -1 if none within R
+  double nn_dist;     // 1 - cos(theta) to the nearest neighbour
+  int prev, next;     // list of jets in the same tile
+};
+
+}  // namespace
+
+EETiledGenKtPlugin::EETiledGenKtPlugin(double R, double p) : m_R(R), m_p(p) {
+  if (!(R > 0.0 && R < fastjet::pi)) {
+    throw std::invalid_argument("Tiled e+e- clustering needs 0 < R < pi");
+  }
+  m_n_per_edge = std::clamp(int(fastjet::pi / 2 / R), 1, kMaxTilesPerEdge);
+  const auto n = m_n_per_edge;
+
+  // Centre and angular radius (to the furthest corner; tile edges are great
+  // circle arcs) of each tile
+  const int n_tiles = 6 * n * n;
+  std::vector<Direction> centre(n_tiles);
+  std::vector<double> radius(n_tiles, 0.0);
+  for (int face = 0; face < 6; ++face) {
+    for (int ia = 0; ia < n; ++ia) {
+      for (int ib = 0; ib < n; ++ib) {
+        auto tile = (face * n + ia) * n + ib;
+        auto a = [n](double i) { return 2.0 * i / n - 1.0; };
+        centre[tile] = face_direction(face, a(ia + 0.5), a(ib + 0.5));
+        for (auto ca : {ia, ia + 1}) {
+          for (auto cb : {ib, ib + 1}) {
+            radius[tile] = std::max(radius[tile], angle(centre[tile], face_direction(face, a(ca), a(cb))));
+          }
+        }
+      }
+    }
+  }
+
+  // Tiles that may hold particles within R of each other, with a small
+  // margin for rounding
+  m_tile_neighbours.resize(n_tiles);
+  for (int t1 = 0; t1 < n_tiles; ++t1) {
+    for (int t2 = 0; t2 < n_tiles; ++t2) {
+      if (angle(centre[t1], centre[t2]) <= radius[t1] + radius[t2] + R * (1.0 + 1.0e-6) + 1.0e-9) {
+        m_tile_neighbours[t1].push_back(t2);
+      }
+    }
+  }
+}
+
+std::string EETiledGenKtPlugin::description() const {
+  std::ostringstream desc;
+  desc << "e+e- generalised kt algorithm with R = " << m_R << " and p = " << m_p << ", tiled on the sphere with "
+       << n_tiles() << " tiles";
+  return desc.str();
+}
+
+double EETiledGenKtPlugin::mean_neighbour_tiles() const {
+  size_t total = 0;
+  for (const auto& neighbours : m_tile_neighbours) total += neighbours.size();
+  return double(total) / m_tile_neighbours.size();
+}
+
+int EETiledGenKtPlugin::tile_index(double x, double y, double z) const {
+  const auto ax = std::fabs(x), ay = std::fabs(y), az = std::fabs(z);
+  int face;
+  double u, v;
+  if (ax >= ay && ax >= az) {
+    if (ax == 0.0) return 0;
+    face = x > 0.0 ? 0 : 1;
+    u = y / ax;
+    v = z / ax;
+  } else if (ay >= az) {
+    face = y > 0.0 ? 2 : 3;
+    u = x / ay;
+    v = z / ay;
+  } else {
+    face = z > 0.0 ? 4 : 5;
+    u = x / az;
+    v = y / az;
+  }
+  const auto n = m_n_per_edge;
+  auto cell = [n](double w) {
+    return std::clamp(int((std::atan(w) / (fastjet::pi / 4) + 1.0) * 0.5 * n), 0, n - 1);
+  };
+  return (face * n + cell(u)) * n + cell(v);
+}
+
+void EETiledGenKtPlugin::run_clustering(fastjet::ClusterSequence& cs) const {
+  const size_t n = cs.jets().size();
+  if (n == 0) return;
+  const double dmax = 1.0 - std::cos(m_R);
+  const double norm = 1.0 / dmax;
+
+  std::vector<TiledJet> tj(n);
+  std::vector<int> tile_head(n_tiles(), -1);
+
+  auto jet_scale = [this](const fastjet::PseudoJet& jet) {
+    if (m_p == 0.0) return 1.0;
+    // Clamped as in ClusterSequence::jet_scale_for_algorithm
+    auto E2 = jet.E() * jet.E();
+    if (m_p <= 0.0 && E2 < 1.0e-300) E2 = 1.0e-300;
+    return std::pow(E2, m_p);
+  };
+  auto set_jet = [&](int slot, int jet_index) {
+    const auto& jet = cs.jets()[jet_index];
+    auto& t = tj[slot];
+    auto modp = jet.modp();
+    if (modp > 0.0) {
+      t.nx = jet.px() / modp;
+      t.ny = jet.py() / modp;
+      t.nz = jet.pz() / modp;
+    } else {
+      t.nx = t.ny = 0.0;
+      t.nz = 1.0;
+    }
+    t.f = jet_scale(jet);
+    t.jet_index = jet_index;
+    t.tile = tile_index(t.nx, t.ny, t.nz);
+    t.prev = -1;
+    t.next = tile_head[t.tile];
+    if (t.next >= 0) tj[t.next].prev = slot;
+    tile_head[t.tile] = slot;
+  };
+  auto remove_from_tile = [&](int slot) {
+    auto& t = tj[slot];
+    if (t.prev >= 0) {
+      tj[t.prev].next = t.next;
+    } else {
+      tile_head[t.tile] = t.next;
+    }
+    if (t.next >= 0) tj[t.next].prev = t.prev;
+  };
+  auto distance = [&](int a, int b) {
+    return 1.0 - (tj[a].nx * tj[b].nx + tj[a].ny * tj[b].ny + tj[a].nz * tj[b].nz);
+  };
+  auto find_nn = [&](int slot) {
+    auto& t = tj[slot];
+    t.nn = -1;
+    t.nn_dist = dmax;
+    for (auto tile : m_tile_neighbours[t.tile]) {
+      for (auto other = tile_head[tile]; other >= 0; other = tj[other].next) {
+        if (other == slot) continue;
+        auto d = distance(slot, other);
+        if (d < t.nn_dist) {
+          t.nn_dist = d;
+          t.nn = other;
+        }
+      }
+    }
+  };
+  // With no neighbour within R this is the beam distance, f
+  auto dij = [&](int slot) {
+    const auto& t = tj[slot];
+    auto f = t.nn >= 0 ? std::min(t.f, tj[t.nn].f) : t.f;
+    return f * t.nn_dist * norm;
+  };
+
+  for (size_t slot = 0; slot < n; ++slot) set_jet(slot, slot);
+  std::vector<double> keys(n);
+  for (size_t slot = 0; slot < n; ++slot) {
+    find_nn(slot);
+    keys[slot] = dij(slot);
+  }
+  IndexedMinHeap heap(keys);
+
+  std::vector<unsigned> tile_stamp(n_tiles(), 0);
+  std::vector<int> affected_tiles;
+  for (unsigned step = 1; step <= n; ++step) {
+    const int i = heap.top();
+    const double d_min = heap.top_key();
+    const int j = tj[i].nn;
+
+    affected_tiles.clear();
+    auto add_neighbour_tiles = [&](int tile) {
+      for (auto neighbour : m_tile_neighbours[tile]) {
+        if (tile_stamp[neighbour] == step) continue;
+        tile_stamp[neighbour] = step;
+        affected_tiles.push_back(neighbour);
+      }
+    };
+    add_neighbour_tiles(tj[i].tile);
+
+    if (j >= 0) {
+      add_neighbour_tiles(tj[j].tile);
+      int k;
+      cs.plugin_record_ij_recombination(tj[i].jet_index, tj[j].jet_index, d_min, k);
+      remove_from_tile(j);
+      heap.remove(j);
+      tj[j].jet_index = -1;
+      remove_from_tile(i);
+      set_jet(i, k);
+      add_neighbour_tiles(tj[i].tile);
+    } else {
+      cs.plugin_record_iB_recombination(tj[i].jet_index, d_min);
+      remove_from_tile(i);
+      heap.remove(i);
+      tj[i].jet_index = -1;
+    }
+
+    // Jets that had i or j as nearest neighbour are within R of them, so
+    // in the affected tiles, as are any jets now closest to the new jet
+    for (auto tile : affected_tiles) {
+      for (auto slot = tile_head[tile]; slot >= 0; slot = tj[slot].next) {
+        if (slot == i) continue;
+        auto& t = tj[slot];
+        if (t.nn == i || (j >= 0 && t.nn == j)) {
+          find_nn(slot);
+          heap.update(slot, dij(slot));
+        } else if (j >= 0) {
+          auto d = distance(slot, i);
+          if (d < t.nn_dist) {
+            t.nn_dist = d;
+            t.nn = i;
+            heap.update(slot, dij(slot));
+          }
+        }
+      }
+    }
+    if (j >= 0) {
+      find_nn(i);
+      heap.update(i, dij(i));
+    }
+  }
+}
+
+namespace {
+
+bool close_enough(double a, double b, double tolerance = 1.0e-8) {
+  return std::fabs(a - b) <= tolerance * std::max({std::fabs(a), std::fabs(b), 1.0e-300});
+}
+
+// Describe the first difference between two clusterings of the same
+// event, or return an empty string if they agree
+std::string compare_clusterings(const fastjet::ClusterSequence& a, const fastjet::ClusterSequence& b) {
+  const auto& ha = a.history();
+  const auto& hb = b.history();
+  if (ha.size() != hb.size()) return "history lengths differ";
+  for (size_t step = a.n_particles(); step < ha.size(); ++step) {
+    if (!close_enough(ha[step].dij, hb[step].dij)) {
+      std::ostringstream diff;
+      diff << "d_ij differs at step " << step - a.n_particles() << ": " << ha[step].dij << " vs " << hb[step].dij;
+      return diff.str();
+    }
+  }
+  auto jets_a = fastjet::sorted_by_E(a.inclusive_jets());
+  auto jets_b = fastjet::sorted_by_E(b.inclusive_jets());
+  if (jets_a.size() != jets_b.size()) return "numbers of inclusive jets differ";
+  for (size_t ijet = 0; ijet < jets_a.size(); ++ijet) {
+    const auto& ja = jets_a[ijet];
+    const auto& jb = jets_b[ijet];
+    auto scale = std::max(ja.E(), 1.0e-300);
+    if (std::fabs(ja.px() - jb.px()) > 1.0e-8 * scale || std::fabs(ja.py() - jb.py()) > 1.0e-8 * scale ||
+        std::fabs(ja.pz() - jb.pz()) > 1.0e-8 * scale || !close_enough(ja.E(), jb.E())) {
+      std::ostringstream diff;
+      diff << "inclusive jet " << ijet << " differs";
+      return diff.str();
+    }
+  }
+  return "";
+}
+
+}  // namespace
+
+bool run_ee_tiled_validation(size_t first_event, size_t n_events,
+                             const std::function<const std::vector<fastjet::PseudoJet>&(size_t)>& get_event,
+                             const fastjet::JetDefinition& native_def, const fastjet::JetDefinition& tiled_def) {
+  using clock = std::chrono::steady_clock;
+  double time_native = 0.0, time_tiled = 0.0;
+  size_t n_particles = 0, n_mismatched = 0;
+
+  for (size_t ievt = first_event; ievt < n_events; ++ievt) {
+    const auto& particles = get_event(ievt);
+    n_particles += particles.size();
+    auto start_t = clock::now();
+    fastjet::ClusterSequence native_cs(particles, native_def);
+    auto native_t = clock::now();
+    fastjet::ClusterSequence tiled_cs(particles, tiled_def);
+    auto tiled_t = clock::now();
+    time_native += std::chrono::duration<double, std::micro>(native_t - start_t).count();
+    time_tiled += std::chrono::duration<double, std::micro>(tiled_t - native_t).count();
+
+    auto difference = compare_clusterings(native_cs, tiled_cs);
+    if (!difference.empty()) {
+      if (n_mismatched < 10) std::cout << "Event " << ievt + 1 << ": " << difference << std::endl;
+      ++n_mismatched;
+    }
+  }
+
+  std::cout << "Tiled e+e- validation: " << tiled_def.plugin()->description() << std::endl;
+  const auto n_used = n_events - first_event;
+  std::cout << "Mean particles per event " << double(n_particles) / n_used << std::endl;
+  std::cout << "Native time per event " << time_native / n_used << " us" << std::endl;
+  std::cout << "Tiled time per event " << time_tiled / n_used << " us" << std::endl;
+  std::cout << "Events differing " << n_mismatched << " of " << n_used << std::endl;
+  return n_mismatched == 0;
+}
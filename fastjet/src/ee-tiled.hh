@@ -0,0 +1,63 @@
+// ee-tiled.hh
+// MIT Licenced, Copyright (c) 2024 CERN
+//
+// Tiled clustering for the e+e- generalised kt algorithm, as a FastJet
+// plugin, where the tiles are cells on the unit sphere
+
+#ifndef EE_TILED_HH
+#define EE_TILED_HH
+
+#include <functional>
+#include <string>
+#include <vector>
+
+#include "fastjet/ClusterSequence.hh"
+#include "fastjet/JetDefinition.hh"
+
+// Clusters exactly as fastjet::ee_genkt_algorithm with the same R and p
+// (R < pi), i.e., d_ij = min(E_i^2p, E_j^2p) (1 - cos theta_ij) / (1 - cos R)
+// and d_iB = E_i^2p, but looks for nearest neighbours only in nearby tiles.
+//
+// Two particles further apart than R never merge (d_iB or d_jB is smaller
+// than d_ij), so the sphere is divided into tiles with a cube map: each
+// face of a cube is split into n x n cells, equal in angle, which are
+// projected onto the sphere. Tiles are about R across, and each tile has
+// the list of tiles that come within R of it (found once, when the plugin
+// is constructed). Nearest neighbour updates after each step then only
+// visit the particles in the neighbouring tiles, and the smallest distance
+// is kept in a binary heap.
+class EETiledGenKtPlugin : public fastjet::JetDefinition::Plugin {
+public:
+  // Throws std::invalid_argument unless 0 < R < pi
+  EETiledGenKtPlugin(double R, double p);
+
+  std::string description() const override;
+  void run_clustering(fastjet::ClusterSequence& cs) const override;
+  double R() const override { return m_R; }
+  bool is_spherical() const override { return true; }
+  // As for ee_genkt_algorithm, exclusive jets are only meaningful for p >= 0
+  bool exclusive_sequence_meaningful() const override { return m_p >= 0.0; }
+
+  size_t n_tiles() const { return m_tile_neighbours.size(); }
+  double mean_neighbour_tiles() const;
+
+  // Tile of a direction (need not be normalised)
+  int tile_index(double x, double y, double z) const;
+
+private:
+  double m_R;
+  double m_p;
+  int m_n_per_edge;
+  // Neighbouring tiles (including the tile itself) of each tile
+  std::vector<std::vector<int>> m_tile_neighbours;
+};
+
+// Cluster events first_event..n_events-1 with a native FastJet jet
+// definition and with the tiled plugin, report the time per event of each,
+// and check that the clustering histories (d_ij of each step) and
+// inclusive jets agree; returns false if any event differs
+bool run_ee_tiled_validation(size_t first_event, size_t n_events,
+                             const std::function<const std::vector<fastjet::PseudoJet>&(size_t)>& get_event,
+                             const fastjet::JetDefinition& native_def, const fastjet::JetDefinition& tiled_def);
+
+#endif
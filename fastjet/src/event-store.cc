@@ -0,0 +1,84 @@
+// event-store.cc
+// MIT Licenced, Copyright (c) 2024 CERN
+//
+// Compressed in-memory store of input events
+
+#include <cmath>
+
+#include "event-store.hh"
+
+namespace {
+
+inline void put_varint(std::vector<uint8_t>& out, int64_t value) {
+  // Zig-zag so that small negative values are also short
+  auto v = (uint64_t(value) << 1) ^ uint64_t(value >> 63);
+  while (v >= 0x80) {
+    out.push_back(uint8_t(v) | 0x80);
+    v >>= 7;
+  }
+  out.push_back(uint8_t(v));
+}
+
+inline int64_t get_varint(const uint8_t*& in) {
+  uint64_t v = 0;
+  int shift = 0;
+  uint8_t byte;
+  do {
+    byte = *in++;
+    v |= uint64_t(byte & 0x7f) << shift;
+    shift += 7;
+  } while (byte & 0x80);
+  return int64_t(v >> 1) ^ -int64_t(v & 1);
+}
+
+// Quantised momentum magnitude, computed identically when encoding and
+// decoding so that the energy residual is exact
+inline int64_t quantised_modp(int64_t px, int64_t py, int64_t pz) {
+  return std::llround(std::sqrt(double(px) * px + double(py) * py + double(pz) * pz));
+}
+
+}  // namespace
+
+CompressedEventStore::CompressedEventStore(double quantum)
+    : m_quantum(quantum), m_inv_quantum(1.0 / quantum) {}
+
+void CompressedEventStore::add_event(const std::vector<fastjet::PseudoJet>& particles) {
+  m_offsets.push_back(m_data.size());
+  m_n_particles.push_back(particles.size());
+  m_total_particles += particles.size();
+  for (const auto& p : particles) {
+    auto px = std::llround(p.px() * m_inv_quantum);
+    auto py = std::llround(p.py() * m_inv_quantum);
+    auto pz = std::llround(p.pz() * m_inv_quantum);
+    auto E = std::llround(p.E() * m_inv_quantum);
+    put_varint(m_data, px);
+    put_varint(m_data, py);
+    put_varint(m_data, pz);
+    put_varint(m_data, E - quantised_modp(px, py, pz));
+  }
+}
+
+void CompressedEventStore::decode_event(size_t ievt, std::vector<fastjet::PseudoJet>& particles) const {
+  const auto n = m_n_particles[ievt];
+  const uint8_t* in = m_data.data() + m_offsets[ievt];
+  particles.resize(n);
+  for (size_t i = 0; i < n; ++i) {
+    auto px = get_varint(in);
+    auto py = get_varint(in);
+    auto pz = get_varint(in);
+    auto E = get_varint(in) + quantised_modp(px, py, pz);
+    particles[i] = fastjet::PseudoJet(px * m_quantum, py * m_quantum, pz * m_quantum, E * m_quantum);
+    particles[i].set_user_index(i);
+  }
+}
+
+void CompressedEventStore::shrink_to_fit() {
+  m_data.shrink_to_fit();
+  m_offsets.shrink_to_fit();
+  m_n_particles.shrink_to_fit();
+}
+
+size_t CompressedEventStore::compressed_bytes() const {
+  return m_data.capacity() + m_offsets.capacity() * sizeof(uint64_t) +
+         m_n_particles.capacity() * sizeof(uint32_t);
+}
@@ -0,0 +1,55 @@
+// event-store.hh
+// MIT Licenced, Copyright (c) 2024 CERN
+//
+// Compressed in-memory store of input events, allowing very large
+// samples to be held in memory for benchmarking
+
+#ifndef EVENT_STORE_HH
+#define EVENT_STORE_HH
+
+#include <cstdint>
+#include <vector>
+
+#include "fastjet/PseudoJet.hh"
+
+// Momenta are quantised in units of the given quantum (in GeV), so the
+// absolute error on each component is at most quantum/2. Each event is
+// encoded as a block of zig-zag varints: px, py and pz directly and E as
+// the difference from the (quantised) momentum magnitude, which is small
+// for light particles. A typical final state particle then takes ~11
+// bytes, instead of the 32 bytes of its four doubles (and much more as a
+// PseudoJet).
+class CompressedEventStore {
+public:
+  CompressedEventStore(double quantum = 1.0e-6);
+
+  void add_event(const std::vector<fastjet::PseudoJet>& particles);
+
+  // Release spare capacity once all events are added
+  void shrink_to_fit();
+
+  // Decode an event into particles (which is overwritten, allowing its
+  // storage to be reused between events); user indexes are set to the
+  // particle index, as for final_state_particles
+  void decode_event(size_t ievt, std::vector<fastjet::PseudoJet>& particles) const;
+
+  size_t size() const { return m_n_particles.size(); }
+  size_t n_particles(size_t ievt) const { return m_n_particles[ievt]; }
+  size_t total_particles() const { return m_total_particles; }
+  double quantum() const { return m_quantum; }
+
+  // Memory used by the compressed store, and by the same particles as
+  // four doubles each
+  size_t compressed_bytes() const;
+  size_t raw_bytes() const { return m_total_particles * 4 * sizeof(double); }
+
+private:
+  double m_quantum;
+  double m_inv_quantum;
+  size_t m_total_particles = 0;
+  std::vector<uint8_t> m_data;
+  std::vector<uint64_t> m_offsets;
+  std::vector<uint32_t> m_n_particles;
+};
+
+#endif
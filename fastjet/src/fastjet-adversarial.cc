@@ -0,0 +1,92 @@
+// fastjet-adversarial.cc
+// MIT Licenced, Copyright (c) 2024 CERN
+//
+// Google Benchmark timings of every clustering strategy on synthetic worst
+// case events, with a fit of the scaling in the number of particles, to
+// show where a strategy degrades (e.g., tiling falling back to a quadratic
+// search with a large constant)
+
+#include <cstdlib>
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include <benchmark/benchmark.h>
+
+#include "fastjet/ClusterSequence.hh"
+#include "fastjet/JetDefinition.hh"
+
+#include "adversarial-events.hh"
+#include "ee-tiled.hh"
+
+namespace {
+
+const double kRadius = 0.4;
+
+struct StrategyChoice {
+  const char* name;
+  fastjet::Strategy strategy;
+};
+
+// AntiKt strategies; N3Dumb is left out, as it is cubic by design
+const std::vector<StrategyChoice> strategies{
+    {"N2Plain", fastjet::N2Plain},
+    {"N2Tiled", fastjet::N2Tiled},
+    {"N2MinHeapTiled", fastjet::N2MinHeapTiled},
+    {"Best", fastjet::Best},
+};
+
+void BM_Adversarial(benchmark::State& state, AdversarialCase adversarial_case,
+                    const fastjet::JetDefinition* jet_def) {
+  auto particles = adversarial_event(adversarial_case, state.range(0), kRadius);
+  for (auto _ : state) {
+    fastjet::ClusterSequence cs(particles, *jet_def);
+    benchmark::DoNotOptimize(cs.history().data());
+  }
+  state.SetComplexityN(state.range(0));
+  state.SetItemsProcessed(state.iterations() * state.range(0));
+}
+
+}  // namespace
+
+int main(int argc, char** argv) {
+  benchmark::Initialize(&argc, argv);
+
+  // An argument is taken as a file name prefix for writing the events out
+  // as HepMC3 files, instead of running the benchmarks
+  if (argc > 2 || (argc == 2 && argv[1][0] == '-')) {
+    std::cerr << "Usage: " << argv[0] << " [benchmark options] [OUTPUT_PREFIX]" << std::endl;
+    return EXIT_FAILURE;
+  } else if (argc == 2) {
+    return write_adversarial_events(argv[1], 1024, kRadius, 10) ? 0 : EXIT_FAILURE;
+  }
+
+  // Jet definitions have to outlive the benchmarks
+  std::vector<fastjet::JetDefinition> jet_defs;
+  jet_defs.reserve(strategies.size() + 2);
+  for (const auto& choice : strategies) {
+    jet_defs.emplace_back(fastjet::antikt_algorithm, kRadius, fastjet::E_scheme, choice.strategy);
+  }
+  // e+e- algorithms, FastJet's own against the tiled plugin
+  EETiledGenKtPlugin ee_tiled(kRadius, -1.0);
+  jet_defs.emplace_back(fastjet::ee_genkt_algorithm, kRadius, -1.0);
+  jet_defs.emplace_back(&ee_tiled);
+  std::vector<std::string> labels;
+  for (const auto& choice : strategies) labels.push_back(std::string("AntiKt/") + choice.name);
+  labels.push_back("EEKt/N2Plain");
+  labels.push_back("EEKt/EETiled");
+
+  for (auto adversarial_case : adversarial_cases()) {
+    for (size_t idef = 0; idef < jet_defs.size(); ++idef) {
+      auto name = std::string("BM_Adversarial/") + adversarial_case_name(adversarial_case) + "/" + labels[idef];
+      benchmark::RegisterBenchmark(name.c_str(), BM_Adversarial, adversarial_case, &jet_defs[idef])
+          ->RangeMultiplier(4)
+          ->Range(64, 4096)
+          ->Complexity();
+    }
+  }
+
+  benchmark::RunSpecifiedBenchmarks();
+  benchmark::Shutdown();
+  return 0;
+}
@@ -7,11 +7,18 @@
 // Original version of this code Philippe Gras, IRFU
 // Modified by Graeme A Stewart, CERN
 
+#include <algorithm>
 #include <iostream> // needed for io
 #include <cstdio>   // needed for io
 #include <string>
 #include <vector>
 #include <chrono>
+#include <cmath>
+#include <fstream>
+#include <memory>
+#include <numeric>
+#include <sstream>
+#include <stdexcept>
 
 #include <unistd.h>
 #include <stdlib.h>
@@ -21,21 +28,50 @@
 
 #include "fastjet/ClusterSequence.hh"
 #include "fastjet/PseudoJet.hh"
+#include "fastjet/config.h"
 
 #include "HepMC3/GenEvent.h"
 #include "HepMC3/GenParticle.h"
 #include "HepMC3/ReaderAscii.h"
 
 #include "fastjet-utils.hh"
+#include "async-input.hh"
+#include "constituent-index.hh"
+#include "ee-tiled.hh"
+#include "event-store.hh"
+#include "flavour.hh"
+#include "input-stages.hh"
+#include "jet-graphs.hh"
+#include "jet-images.hh"
+#include "jet-selection.hh"
+#include "page-cache.hh"
+#include "parallel.hh"
+#include "premerge.hh"
+#include "pileup.hh"
+#include "roi.hh"
+#include "slow-events.hh"
+#include "soak.hh"
+#include "subsample.hh"
+#include "towers.hh"
+#ifdef FASTJET_FINDER_HAVE_ARROW
+#include "arrow-output.hh"
+#endif
 
 using namespace std;
 using namespace popl;
 using Time = std::chrono::high_resolution_clock;
+
+// FastJet is only thread safe when configured with
+// --enable-limited-thread-safety or --enable-thread-safety
+#if defined(FASTJET_HAVE_LIMITED_THREAD_SAFETY) || defined(FASTJET_HAVE_THREAD_SAFETY)
+constexpr bool kFastJetThreadSafe = true;
+#else
+constexpr bool kFastJetThreadSafe = false;
+#endif
 using us = std::chrono::microseconds;
 
-fastjet::ClusterSequence run_fastjet_clustering(std::vector<fastjet::PseudoJet> input_particles,
-  fastjet::Strategy strategy, fastjet::JetAlgorithm algorithm, fastjet::RecombinationScheme recombine_scheme, 
-  double R, double p) {
+fastjet::JetDefinition make_jet_definition(fastjet::Strategy strategy, fastjet::JetAlgorithm algorithm,
+  fastjet::RecombinationScheme recombine_scheme, double R, double p) {
 
   fastjet::JetDefinition jet_definition;
   if (algorithm == fastjet::genkt_algorithm || algorithm == fastjet::ee_genkt_algorithm) {
@@ -45,8 +81,13 @@ fastjet::ClusterSequence run_fastjet_clustering(std::vector<fastjet::PseudoJet>
   } else {
     jet_definition = fastjet::JetDefinition(algorithm, R, recombine_scheme, strategy);
   }
+  return jet_definition;
+}
 
-  // run the jet clustering with the above jet definition
+fastjet::ClusterSequence run_fastjet_clustering(std::vector<fastjet::PseudoJet> input_particles,
+  const fastjet::JetDefinition& jet_definition) {
+
+  // run the jet clustering with the given jet definition
   fastjet::ClusterSequence clust_seq(input_particles, jet_definition);
 
   return clust_seq;
@@ -73,6 +114,32 @@ void dump_clusterseq(fastjet::ClusterSequence clust_seq) {
   }
 }
 
+// Drop the input file from the page cache and report how much was resident
+void evict_input_file(const std::string& input_file) {
+  auto residency = page_cache_residency(input_file);
+  if (!evict_from_page_cache(input_file)) return;
+  std::cout << "Page cache residency of " << input_file << ": " << 100.0 * residency << "% before eviction, " <<
+    100.0 * page_cache_residency(input_file) << "% after" << std::endl;
+}
+
+void cold_load_benchmark(const std::string& input_file, long maxevents) {
+  // Time reading and parsing of the input (to final state particles, which
+  // are discarded), first from storage, then from the page cache
+  const auto bytes = file_size(input_file);
+  for (auto label : {"Cold", "Warm"}) {
+    size_t n_particles = 0;
+    auto start_t = std::chrono::steady_clock::now();
+    auto n_events = for_each_input_event(input_file.c_str(), maxevents, [&](const HepMC3::GenEvent& evt) {
+      n_particles += final_state_particles(evt).size();
+    });
+    auto seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start_t).count();
+    std::cout << label << " load: " << n_events << " events (" << n_particles << " particles) in " << seconds << " s, ";
+    // The byte rate is only meaningful if the whole file was read
+    if (maxevents < 0) std::cout << bytes / seconds / 1.0e6 << " MB/s, ";
+    std::cout << n_events / seconds << " events/s" << std::endl;
+  }
+}
+
 int main(int argc, char* argv[]) {
   // Default values
   int maxevents = -1;
@@ -84,13 +151,16 @@ int main(int argc, char* argv[]) {
   string recombine = "";
   double R = 0.4;
   string dump_file = "";
+  int topk = -1;
+  int threads = 1;
+  string jet_fields = "rap,phi,pt";
 
   OptionParser opts("Allowed options");
   auto help_option = opts.add<Switch>("h", "help", "produce help message");
   auto max_events_option = opts.add<Value<int>>("m", "maxevents", "Maximum events in file to process (-1 = all events)", maxevents, &maxevents);
   auto skip_events_option = opts.add<Value<int>>("", "skipevents", "Number of events to skip over (0 = none)", skip_events, &skip_events);
   auto trials_option = opts.add<Value<int>>("n", "trials", "Number of repeated trials", trials, &trials);
-  auto strategy_option = opts.add<Value<string>>("s", "strategy", "Valid values are 'Best' (default), 'N2Plain', 'N2Tiled'", mystrategy, &mystrategy);
+  auto strategy_option = opts.add<Value<string>>("s", "strategy", "Valid values are 'Best' (default), 'N2Plain', 'N2Tiled', 'EETiled' (EEKt only)", mystrategy, &mystrategy);
   auto power_option = opts.add<Value<double>>("p", "power", "Algorithm p value: -1=antikt, 0=cambridge_aachen, 1=inclusive kt; otherwise generalised Kt", power, &power);
   auto alg_option = opts.add<Value<string>>("A", "algorithm", "Algorithm: AntiKt CA Kt GenKt EEKt Durham (overrides power)", alg, &alg);
   auto radius_option = opts.add<Value<double>>("R", "radius", "Algorithm R parameter", R, &R);
@@ -98,7 +168,58 @@ int main(int argc, char* argv[]) {
   auto ptmin_option = opts.add<Value<double>>("", "ptmin", "pt cut for inclusive jets");
   auto dijmax_option = opts.add<Value<double>>("", "dijmax", "dijmax value for exclusive jets");
   auto njets_option = opts.add<Value<int>>("", "njets", "njets value for exclusive jets");
+  auto topk_option = opts.add<Value<int>>("k", "topk", "Keep only the leading K jets, by pt (-1 = all jets)", topk, &topk);
+  auto nosort_option = opts.add<Switch>("", "nosort", "Do not order the final jets by pt (ignored if topk is set)");
   auto dump_option = opts.add<Value<string>>("d", "dump", "Filename to dump jets to");
+  auto fields_option = opts.add<Value<string>>("", "fields", "Comma separated jet fields to dump: rap,eta,phi,pt,px,py,pz,E,m,nconst,constituents or p4", jet_fields, &jet_fields);
+  auto arrow_option = opts.add<Value<string>>("", "arrow", "Filename to write selected jets to as an Arrow IPC stream");
+  auto arrow_constituents_option = opts.add<Switch>("", "arrow-constituents", "Add constituent particle indices to the Arrow output");
+  auto arrow_batch_option = opts.add<Value<int>>("", "arrow-batch", "Number of jets per Arrow record batch", 65536);
+  auto images_option = opts.add<Value<string>>("", "images", "Filename to write a pt image of each selected jet to, as a NumPy .npy array");
+  auto image_pixels_option = opts.add<Value<int>>("", "image-pixels", "Jet image size in pixels (per side)", 32);
+  auto image_width_option = opts.add<Value<double>>("", "image-width", "Jet image half width in delta eta and delta phi (default: R)");
+  auto image_batch_option = opts.add<Value<int>>("", "image-batch", "Number of jet images per write", 1024);
+  auto graphs_option = opts.add<Value<string>>("", "graphs", "Filename to write the k-nearest-neighbour constituent graph of each selected jet to");
+  auto graph_k_option = opts.add<Value<int>>("", "graph-k", "Number of nearest neighbours of each constituent in jet graphs", 16);
+  auto graph_compare_option = opts.add<Switch>("", "graph-compare", "Time the bucketed jet graph search against all pairs distances and compare the graphs");
+  auto constituents_option = opts.add<Switch>("", "constituents", "Build the flat constituent index of the final jets of every event and time it against PseudoJet::constituents()");
+  auto compress_option = opts.add<Switch>("", "compress", "Hold input events in a compressed in-memory store, decoded just before clustering");
+  auto quantum_option = opts.add<Value<double>>("", "compress-quantum", "Momentum quantisation step for the compressed store (GeV)", 1.0e-6);
+  auto soak_option = opts.add<Value<double>>("", "soak", "Run clustering continuously for this many seconds, monitoring memory and throughput");
+  auto soak_interval_option = opts.add<Value<double>>("", "soak-interval", "Seconds between soak monitoring samples", 60.0);
+  auto soak_radii_option = opts.add<Value<string>>("", "soak-radii", "Comma separated R values to cycle through in soak mode (default: R)");
+  auto soak_report_option = opts.add<Value<string>>("", "soak-report", "CSV file for soak monitoring samples (default: stdout)");
+  auto roi_option = opts.add<Value<double>>("", "roi", "Restrict clustering to particles within this distance of seeds and compare to full event clustering");
+  auto roi_seeds_option = opts.add<Value<int>>("", "roi-seeds", "Number of leading particles used as RoI seeds", 2);
+  auto roi_seed_ptmin_option = opts.add<Value<double>>("", "roi-seed-ptmin", "Minimum pt of RoI seed particles", 0.0);
+  auto roi_seed_file_option = opts.add<Value<string>>("", "roi-seed-file", "File of external RoI seeds (lines of: event rap phi)");
+  auto softkiller_option = opts.add<Value<double>>("", "softkiller", "Apply SoftKiller with this grid size before clustering");
+  auto softkiller_rapmax_option = opts.add<Value<double>>("", "softkiller-rapmax", "Rapidity extent of the SoftKiller grid", 5.0);
+  auto chs_option = opts.add<Switch>("", "chs", "Apply charged hadron subtraction before clustering (needs pileup provenance)");
+  auto puppi_option = opts.add<Value<double>>("", "puppi", "Apply PUPPI-like weighting with this neighbourhood radius before clustering");
+  auto puppi_wcut_option = opts.add<Value<double>>("", "puppi-wcut", "Minimum PUPPI weight for a particle to be kept", 0.1);
+  auto premerge_option = opts.add<Value<double>>("", "premerge", "Merge particles closer than this dR before clustering");
+  auto premerge_impact_option = opts.add<Switch>("", "premerge-impact", "Compare clustering with and without pre-merging (time and jets)");
+  auto flavour_option = opts.add<Switch>("", "flavour", "Label jets as b, c or light by clustering the b and c hadrons as ghosts, and time it against plain clustering");
+  auto towers_option = opts.add<Value<double>>("", "towers", "Replace particles by calorimeter towers of this (eta, phi) size before clustering");
+  auto towers_etamax_option = opts.add<Value<double>>("", "towers-etamax", "Pseudorapidity extent of the tower grid", 4.9);
+  auto estimate_option = opts.add<Value<double>>("", "estimate", "Estimate the time per event by timing this fraction of events, stratified by multiplicity");
+  auto estimate_strata_option = opts.add<Value<int>>("", "estimate-strata", "Number of multiplicity strata for the estimate", 8);
+  auto estimate_validate_option = opts.add<Switch>("", "estimate-validate", "Also time all events and compare to the estimate");
+  auto slowest_option = opts.add<Value<int>>("", "slowest", "Write the K slowest events (lowest time over trials) to a replay file");
+  auto slowest_per_particle_option = opts.add<Switch>("", "slowest-per-particle", "Rank slow events by time per particle");
+  auto slowest_file_option = opts.add<Value<string>>("", "slowest-file", "HepMC3 replay file for the slowest events", "slowest-events.hepmc3");
+  auto replay_option = opts.add<Switch>("", "replay", "Time each event on its own, trials times in a row (e.g., for a replay file of slow events)");
+  auto stream_option = opts.add<Switch>("", "stream", "Cluster events as they are read from the input file, instead of preloading them");
+  auto io_option = opts.add<Value<string>>("", "io", "Input reader for streaming: uring (io_uring, falling back to pread), pread or std", "uring");
+  auto io_block_option = opts.add<Value<int>>("", "io-block", "Streaming read size (KiB)", 1024);
+  auto io_depth_option = opts.add<Value<int>>("", "io-depth", "Number of streaming reads kept in flight", 4);
+  auto cold_option = opts.add<Switch>("", "cold", "Evict the input file from the page cache before reading, and report cold and warm load throughput");
+  auto direct_option = opts.add<Switch>("", "direct", "Read the input with O_DIRECT when streaming, bypassing the page cache");
+  auto threads_option = opts.add<Value<int>>("t", "threads", "Number of threads processing events in parallel", threads, &threads);
+  auto parallel_backend_option = opts.add<Value<string>>("", "parallel-backend", "Parallel runtime: pool (std::thread pool), openmp or tbb", "pool");
+  auto parallel_compare_option = opts.add<Switch>("", "parallel-compare", "Run the parallel event loop with every available backend and compare them");
+  auto validate_ee_tiled_option = opts.add<Switch>("", "validate-ee-tiled", "Compare EETiled clustering with FastJet's own EEKt clustering for every event");
   auto debug_clusterseq_option = opts.add<Switch>("c", "debug-clusterseq", "Dump cluster sequence jet and history content");
 
   opts.parse(argc, argv);
@@ -129,9 +250,148 @@ int main(int argc, char* argv[]) {
     exit(EXIT_FAILURE);
   }
 
+  if (topk == 0 || topk < -1) {
+    cerr << "The number of leading jets to keep must be at least 1, or -1 for all jets (currently " << topk << ")" << endl;
+    exit(EXIT_FAILURE);
+  }
+
+  if (threads < 1) {
+    cerr << "Number of threads must be at least 1 (currently " << threads << ")" << endl;
+    exit(EXIT_FAILURE);
+  }
+
+  unsigned int dump_fields = kDefaultJetFields;
+  try {
+    dump_fields = parse_jet_fields(jet_fields);
+  } catch (const std::invalid_argument& e) {
+    cerr << e.what() << endl;
+    exit(EXIT_FAILURE);
+  }
+  bool order_jets = topk > 0 || !nosort_option->is_set();
+
   // read in input events
   //----------------------------------------------------------
-  auto events = read_input_events(input_file.c_str(), maxevents);
+  std::vector<std::vector<fastjet::PseudoJet>> events;
+  if (!(quantum_option->value() > 0.0) || !std::isfinite(quantum_option->value())) {
+    cerr << "Compression quantum must be positive and finite" << endl;
+    exit(EXIT_FAILURE);
+  }
+  CompressedEventStore event_store(quantum_option->value());
+  const bool need_particle_info = chs_option->is_set() || puppi_option->is_set();
+  std::vector<std::vector<ParticleInfo>> particle_info;
+  std::vector<std::vector<fastjet::PseudoJet>> flavour_hadrons;
+  std::vector<int> event_numbers;
+  if (stream_option->is_set() && (compress_option->is_set() || soak_option->is_set() ||
+                                  roi_option->is_set() || estimate_option->is_set() ||
+                                  slowest_option->is_set() || replay_option->is_set() ||
+                                  flavour_option->is_set())) {
+    cerr << "Streaming can not be combined with compress, soak, roi, estimate, slowest, replay or flavour modes" << endl;
+    exit(EXIT_FAILURE);
+  }
+  if (stream_option->is_set() && (dump_option->is_set() || arrow_option->is_set() || images_option->is_set() ||
+                                  graphs_option->is_set() || graph_compare_option->is_set() ||
+                                  constituents_option->is_set() || threads > 1 ||
+                                  parallel_compare_option->is_set() || premerge_impact_option->is_set() ||
+                                  validate_ee_tiled_option->is_set() || trials > 1)) {
+    cerr << "Streaming runs a single trial on one thread without outputs: it can not be combined with dump, " <<
+      "Arrow, jet image, jet graph or constituent index output, parallel runs, pre-merging impact, " <<
+      "EETiled validation or more than one trial" << endl;
+    exit(EXIT_FAILURE);
+  }
+  if (io_block_option->value() < 1 || io_depth_option->value() < 1) {
+    cerr << "Streaming read size and number of reads in flight must be at least 1" << endl;
+    exit(EXIT_FAILURE);
+  }
+  if (direct_option->is_set() && (!stream_option->is_set() || io_option->value() == "std")) {
+    cerr << "O_DIRECT reads need streaming with the uring or pread reader" << endl;
+    exit(EXIT_FAILURE);
+  }
+  if (cold_option->is_set()) {
+    evict_input_file(input_file);
+    if (!stream_option->is_set()) cold_load_benchmark(input_file, maxevents);
+  }
+  if (!stream_option->is_set()) {
+    auto events_parsed = for_each_input_event(input_file.c_str(), maxevents, [&](const HepMC3::GenEvent& evt) {
+      if (compress_option->is_set()) {
+        event_store.add_event(final_state_particles(evt));
+      } else {
+        events.push_back(final_state_particles(evt));
+      }
+      if (need_particle_info) particle_info.push_back(final_state_info(evt));
+      if (flavour_option->is_set()) flavour_hadrons.push_back(heavy_flavour_hadrons(evt));
+      if (replay_option->is_set() || slowest_option->is_set()) event_numbers.push_back(evt.event_number());
+    });
+    cout << "Read " << events_parsed << " events from " << input_file << endl;
+  }
+  if (compress_option->is_set()) {
+    event_store.shrink_to_fit();
+    cout << "Compressed store: " << event_store.compressed_bytes() << " bytes (" <<
+      double(event_store.compressed_bytes()) / event_store.total_particles() << " bytes/particle; " <<
+      event_store.raw_bytes() << " bytes as doubles)" << endl;
+  }
+  const size_t n_events = compress_option->is_set() ? event_store.size() : events.size();
+
+  // Pre-clustering stages, applied in this order
+  std::vector<InputStage> input_stages;
+  if (chs_option->is_set()) {
+    bool provenance = std::any_of(particle_info.begin(), particle_info.end(), has_pileup_provenance);
+    if (!provenance && !stream_option->is_set()) {
+      cerr << "Warning: no pileup provenance found in " << input_file <<
+        ", charged hadron subtraction will have no effect" << endl;
+    }
+    input_stages.push_back({"CHS", [&](size_t ievt, std::vector<fastjet::PseudoJet>& particles) {
+      charged_hadron_subtraction(particles, particle_info[ievt]);
+    }});
+  }
+  if (softkiller_option->is_set()) {
+    auto grid_size = softkiller_option->value();
+    auto rapmax = softkiller_rapmax_option->value();
+    if (!(grid_size > 0.0) || !(rapmax > 0.0)) {
+      cerr << "SoftKiller grid size and extent must be positive" << endl;
+      exit(EXIT_FAILURE);
+    }
+    input_stages.push_back({"SoftKiller", [grid_size, rapmax](size_t, std::vector<fastjet::PseudoJet>& particles) {
+      softkiller(particles, grid_size, rapmax);
+    }});
+  }
+  if (puppi_option->is_set()) {
+    auto R0 = puppi_option->value();
+    auto wcut = puppi_wcut_option->value();
+    if (!(R0 > 0.0)) {
+      cerr << "PUPPI neighbourhood radius must be positive" << endl;
+      exit(EXIT_FAILURE);
+    }
+    input_stages.push_back({"PUPPI", [&, R0, wcut](size_t ievt, std::vector<fastjet::PseudoJet>& particles) {
+      puppi_weights(particles, &particle_info[ievt], R0, wcut);
+    }});
+  }
+  if (premerge_impact_option->is_set() && !premerge_option->is_set()) {
+    cerr << "The pre-merging impact report needs a pre-merging dR (--premerge)" << endl;
+    exit(EXIT_FAILURE);
+  }
+  if (premerge_impact_option->is_set() && towers_option->is_set()) {
+    cerr << "The pre-merging impact report can not be combined with towers, which follow pre-merging" << endl;
+    exit(EXIT_FAILURE);
+  }
+  // For the impact report, pre-merging is done separately, after any other
+  // stages
+  if (premerge_option->is_set() && !premerge_impact_option->is_set()) {
+    auto dR = premerge_option->value();
+    input_stages.push_back({"Premerge", [dR](size_t, std::vector<fastjet::PseudoJet>& particles) {
+      collinear_premerge(particles, dR);
+    }});
+  }
+  if (towers_option->is_set()) {
+    auto tower_size = towers_option->value();
+    auto etamax = towers_etamax_option->value();
+    if (tower_size <= 0.0 || etamax <= 0.0) {
+      cerr << "Tower size and extent must be positive" << endl;
+      exit(EXIT_FAILURE);
+    }
+    input_stages.push_back({"Towers", [tower_size, etamax](size_t, std::vector<fastjet::PseudoJet>& particles) {
+      calorimeter_towers(particles, tower_size, etamax);
+    }});
+  }
   
   // Set strategy
   fastjet::Strategy strategy = fastjet::Best;
@@ -186,6 +446,374 @@ int main(int argc, char* argv[]) {
   std::cout << "Strategy: " << mystrategy << "; Power: " << power << "; Algorithm " << algorithm << 
     "; Recombine " << recombine_scheme << std::endl;
 
+  // Jet definition for a given radius; the EETiled strategy uses the tiled
+  // plugin, which has to outlive its jet definitions
+  const bool ee_tiled = mystrategy == "EETiled" || validate_ee_tiled_option->is_set();
+  if (ee_tiled && algorithm != fastjet::ee_genkt_algorithm) {
+    cerr << "The EETiled strategy is only available for the EEKt algorithm" << endl;
+    exit(EXIT_FAILURE);
+  }
+  std::vector<std::unique_ptr<EETiledGenKtPlugin>> ee_tiled_plugins;
+  auto jet_definition = [&](double radius) {
+    if (mystrategy != "EETiled") return make_jet_definition(strategy, algorithm, recombine_scheme, radius, power);
+    try {
+      ee_tiled_plugins.emplace_back(new EETiledGenKtPlugin(radius, power));
+    } catch (const std::invalid_argument& e) {
+      cerr << e.what() << endl;
+      exit(EXIT_FAILURE);
+    }
+    fastjet::JetDefinition plugin_definition(ee_tiled_plugins.back().get());
+    plugin_definition.set_recombination_scheme(recombine_scheme);
+    return plugin_definition;
+  };
+
+  // Final jets of an event, as requested by the user
+  auto select_final_jets = [&](const fastjet::ClusterSequence& cluster_sequence) {
+    vector<fastjet::PseudoJet> final_jets;
+    if (ptmin_option->is_set()) {
+      final_jets = cluster_sequence.inclusive_jets(ptmin_option->value());
+    } else if (dijmax_option->is_set()) {
+      final_jets = cluster_sequence.exclusive_jets(dijmax_option->value());
+    } else if (njets_option->is_set()) {
+      final_jets = cluster_sequence.exclusive_jets(njets_option->value());
+    }
+    if (order_jets) select_leading_jets(final_jets, topk);
+    return final_jets;
+  };
+
+  // Input particles of an event, decoding from the compressed store if needed
+  std::vector<fastjet::PseudoJet> decoded_particles;
+  auto get_event = [&](size_t ievt) -> const std::vector<fastjet::PseudoJet>& {
+    if (compress_option->is_set()) {
+      event_store.decode_event(ievt, decoded_particles);
+      return decoded_particles;
+    }
+    return events[ievt];
+  };
+
+  if (stream_option->is_set()) {
+    // Events are parsed, clustered and discarded one at a time; the input
+    // stages then see the current event's particle information at index 0
+    std::unique_ptr<AsyncFileBuf> async_buf;
+    std::unique_ptr<std::istream> input;
+    if (io_option->value() == "std") {
+      input.reset(new std::ifstream(input_file));
+    } else if (io_option->value() == "uring" || io_option->value() == "pread") {
+      auto backend = io_option->value() == "uring" ? AsyncReadBackend::IoUring : AsyncReadBackend::Pread;
+      async_buf.reset(new AsyncFileBuf(input_file, backend, size_t(io_block_option->value()) * 1024,
+        io_depth_option->value(), direct_option->is_set()));
+      if (!async_buf->is_open()) exit(EXIT_FAILURE);
+      input.reset(new std::istream(async_buf.get()));
+    } else {
+      cerr << "Unknown input reader: " << io_option->value() << endl;
+      exit(EXIT_FAILURE);
+    }
+
+    auto jet_def = jet_definition(R);
+    double us_cluster = 0.0;
+    double us_stages = 0.0;
+    long ievt = 0;
+    auto start_t = std::chrono::steady_clock::now();
+    auto n_streamed = for_each_input_event(*input, maxevents, [&](const HepMC3::GenEvent& evt) {
+      if (ievt++ < skip_events) return;
+      auto particles = final_state_particles(evt);
+      if (need_particle_info) particle_info.assign(1, final_state_info(evt));
+      if (!input_stages.empty()) us_stages += apply_input_stages(input_stages, 0, particles);
+      auto cluster_start_t = std::chrono::steady_clock::now();
+      fastjet::ClusterSequence cluster_sequence(particles, jet_def);
+      select_final_jets(cluster_sequence);
+      auto cluster_stop_t = std::chrono::steady_clock::now();
+      us_cluster += chrono::duration<double, std::micro>(cluster_stop_t - cluster_start_t).count();
+    });
+    auto us_elapsed = chrono::duration<double, std::micro>(std::chrono::steady_clock::now() - start_t).count();
+
+    auto n_clustered = std::max(n_streamed - skip_events, 1L);
+    std::cout << "Streamed " << n_streamed << " events from " << input_file << " in " << us_elapsed / 1.0e6 <<
+      " s (" << io_option->value() << " reader" << (async_buf && async_buf->direct() ? ", O_DIRECT" : "") <<
+      (cold_option->is_set() ? ", cold" : "") << ")" << endl;
+    std::cout << "Time per event " << us_elapsed / n_clustered << " us" << endl;
+    std::cout << "Clustering time per event " << us_cluster / n_clustered << " us" << endl;
+    if (!input_stages.empty()) {
+      std::cout << "Pre-clustering time per event " << us_stages / n_clustered << " us" << endl;
+      print_input_stage_summary(input_stages, std::cout);
+    }
+    std::cout << "Input (read and parse) time per event " << (us_elapsed - us_cluster - us_stages) / n_clustered <<
+      " us" << endl;
+    if (async_buf) {
+      const auto& io_stats = async_buf->stats();
+      std::cout << "Input backend " << backend_name(async_buf->backend()) << ": " << io_stats.reads << " reads, " <<
+        io_stats.bytes / (us_elapsed) << " MB/s, mean queue depth " << io_stats.mean_depth() << " (max " <<
+        io_stats.max_depth << "), stalled on " << io_stats.stalls << " of " << io_stats.waits << " blocks for " <<
+        io_stats.stall_us / 1.0e3 << " ms" << endl;
+    }
+    return 0;
+  }
+
+  if (validate_ee_tiled_option->is_set()) {
+    // The tiled plugin against FastJet's own clustering with the chosen
+    // strategy (Best by default)
+    std::unique_ptr<EETiledGenKtPlugin> plugin;
+    try {
+      plugin.reset(new EETiledGenKtPlugin(R, power));
+    } catch (const std::invalid_argument& e) {
+      cerr << e.what() << endl;
+      exit(EXIT_FAILURE);
+    }
+    fastjet::JetDefinition tiled_definition(plugin.get());
+    tiled_definition.set_recombination_scheme(recombine_scheme);
+    auto native_definition = make_jet_definition(strategy, algorithm, recombine_scheme, R, power);
+    if (size_t(skip_events) >= n_events) {
+      cerr << "No events left for EETiled validation after skipping " << skip_events << endl;
+      exit(EXIT_FAILURE);
+    }
+    return run_ee_tiled_validation(skip_events, n_events, get_event, native_definition, tiled_definition) ?
+      0 : EXIT_FAILURE;
+  }
+
+  // Input particles of an event after the pre-clustering stages
+  std::vector<fastjet::PseudoJet> staged_event;
+  auto get_staged_event = [&](size_t ievt) -> const std::vector<fastjet::PseudoJet>& {
+    if (input_stages.empty()) return get_event(ievt);
+    staged_event = get_event(ievt);
+    apply_input_stages(input_stages, ievt, staged_event);
+    return staged_event;
+  };
+
+  if (roi_option->is_set()) {
+    if (!ptmin_option->is_set()) {
+      cerr << "RoI clustering needs inclusive jets (--ptmin)" << endl;
+      exit(EXIT_FAILURE);
+    }
+    RoiOptions roi_options;
+    roi_options.radius = roi_option->value();
+    roi_options.n_seeds = roi_seeds_option->value();
+    roi_options.seed_ptmin = roi_seed_ptmin_option->value();
+    roi_options.ptmin = ptmin_option->value();
+    roi_options.trials = trials;
+    std::vector<std::vector<RoiSeed>> external_seeds;
+    if (roi_seed_file_option->is_set()) {
+      external_seeds = read_roi_seeds(roi_seed_file_option->value());
+    }
+    if (size_t(skip_events) >= n_events) {
+      cerr << "No events left for RoI clustering after skipping " << skip_events << endl;
+      exit(EXIT_FAILURE);
+    }
+    run_roi_benchmark(roi_options, skip_events, n_events, get_staged_event, external_seeds,
+      jet_definition(R));
+    return 0;
+  }
+
+  if (estimate_option->is_set()) {
+    if (size_t(skip_events) >= n_events) {
+      cerr << "No events left for the estimate after skipping " << skip_events << endl;
+      exit(EXIT_FAILURE);
+    }
+    SubsampleOptions subsample_options;
+    subsample_options.fraction = estimate_option->value();
+    subsample_options.n_strata = estimate_strata_option->value();
+    subsample_options.trials = trials;
+    subsample_options.validate = estimate_validate_option->is_set();
+
+    std::vector<size_t> multiplicities(n_events);
+    for (size_t ievt = 0; ievt < n_events; ++ievt) {
+      multiplicities[ievt] = compress_option->is_set() ? event_store.n_particles(ievt) : events[ievt].size();
+    }
+
+    // Only the clustering and jet selection are timed, as in the main loop
+    auto jet_def = jet_definition(R);
+    run_subsample_estimate(subsample_options, skip_events, multiplicities, [&](size_t ievt) {
+      const auto& input_particles = get_staged_event(ievt);
+      auto start_t = std::chrono::steady_clock::now();
+      fastjet::ClusterSequence cluster_sequence(input_particles, jet_def);
+      select_final_jets(cluster_sequence);
+      auto stop_t = std::chrono::steady_clock::now();
+      return chrono::duration<double, std::micro>(stop_t - start_t).count();
+    });
+    return 0;
+  }
+
+  if (replay_option->is_set()) {
+    // Multiplicities of the clustered (staged) events, as in the main loop
+    std::vector<size_t> multiplicities(n_events);
+    for (size_t ievt = 0; ievt < n_events; ++ievt) {
+      multiplicities[ievt] = get_staged_event(ievt).size();
+    }
+
+    // Only the clustering and jet selection are timed, as in the main loop
+    auto jet_def = jet_definition(R);
+    run_replay_benchmark(skip_events, multiplicities, event_numbers, trials, [&](size_t ievt) {
+      const auto& input_particles = get_staged_event(ievt);
+      auto start_t = std::chrono::steady_clock::now();
+      fastjet::ClusterSequence cluster_sequence(input_particles, jet_def);
+      select_final_jets(cluster_sequence);
+      auto stop_t = std::chrono::steady_clock::now();
+      return chrono::duration<double, std::micro>(stop_t - start_t).count();
+    });
+    return 0;
+  }
+
+  if (premerge_impact_option->is_set()) {
+    run_premerge_impact(premerge_option->value(), trials, skip_events, n_events, get_staged_event,
+      jet_definition(R), select_final_jets);
+    return 0;
+  }
+
+  if (flavour_option->is_set()) {
+    run_flavour_benchmark(trials, skip_events, n_events, get_staged_event, flavour_hadrons, jet_definition(R),
+      select_final_jets);
+    return 0;
+  }
+
+  if (soak_option->is_set()) {
+    // Each configuration is the main jet definition with a different radius
+    std::vector<fastjet::JetDefinition> soak_definitions;
+    if (soak_radii_option->is_set()) {
+      std::istringstream radii(soak_radii_option->value());
+      std::string radius;
+      while (std::getline(radii, radius, ',')) {
+        double soak_R = 0.0;
+        try {
+          soak_R = std::stod(radius);
+        } catch (const std::logic_error&) {
+          // invalid_argument or out_of_range, reported below
+        }
+        if (!(soak_R > 0.0)) {
+          cerr << "Bad soak radius '" << radius << "' in " << soak_radii_option->value() << endl;
+          exit(EXIT_FAILURE);
+        }
+        soak_definitions.push_back(jet_definition(soak_R));
+      }
+    } else {
+      soak_definitions.push_back(jet_definition(R));
+    }
+
+    if (soak_definitions.empty() || size_t(skip_events) >= n_events) {
+      cerr << "Soak testing needs at least one radius and one event after any skipped" << endl;
+      exit(EXIT_FAILURE);
+    }
+
+    SoakOptions soak_options;
+    soak_options.duration_s = soak_option->value();
+    soak_options.interval_s = soak_interval_option->value();
+    soak_options.n_configs = soak_definitions.size();
+    soak_options.first_event = skip_events;
+
+    auto report_fh = stdout;
+    if (soak_report_option->is_set()) {
+      report_fh = fopen(soak_report_option->value().c_str(), "w");
+      if (!report_fh) {
+        cerr << "Failed to open soak report file " << soak_report_option->value() << endl;
+        exit(EXIT_FAILURE);
+      }
+    }
+
+    auto soak_ok = run_soak(soak_options, n_events, [&](size_t ievt, size_t iconfig) {
+      fastjet::ClusterSequence cluster_sequence(get_staged_event(ievt), soak_definitions[iconfig]);
+      select_final_jets(cluster_sequence);
+    }, report_fh);
+
+    if (report_fh != stdout) fclose(report_fh);
+    return soak_ok ? 0 : EXIT_FAILURE;
+  }
+
+  if (threads > 1 || parallel_compare_option->is_set()) {
+    if (!input_stages.empty() || dump_option->is_set() || arrow_option->is_set() || images_option->is_set() ||
+        graphs_option->is_set() || graph_compare_option->is_set() || slowest_option->is_set() ||
+        constituents_option->is_set()) {
+      cerr << "Pre-clustering stages, dump, Arrow output, jet images and graphs, constituent indexes and slow event capture are not supported for parallel runs" << endl;
+      exit(EXIT_FAILURE);
+    }
+    if (threads > 1 && !kFastJetThreadSafe) {
+      cerr << "Warning: FastJet was not configured with --enable-limited-thread-safety or --enable-thread-safety, "
+        "parallel clustering may not be safe" << endl;
+    }
+    std::vector<ParallelBackend> backends;
+    try {
+      if (parallel_compare_option->is_set()) {
+        backends = available_backends();
+      } else {
+        backends.push_back(parse_parallel_backend(parallel_backend_option->value()));
+      }
+    } catch (const std::invalid_argument& e) {
+      cerr << e.what() << endl;
+      exit(EXIT_FAILURE);
+    }
+
+    // Every backend runs exactly the same work: all events, every trial,
+    // with per-thread decoding buffers; the jet count checks this
+    auto jet_def = jet_definition(R);
+    const size_t first_event = skip_events;
+    const size_t n_items = n_events > first_event ? n_events - first_event : 0;
+    if (n_items == 0) {
+      cerr << "No events left for the parallel run after skipping " << skip_events << endl;
+      exit(EXIT_FAILURE);
+    }
+    // The first clustering of the process initialises FastJet's statics
+    // (and prints the banner), so it is done before any threads start
+    {
+      fastjet::ClusterSequence first_cluster_sequence(get_event(first_event), jet_def);
+    }
+    struct BackendResult {
+      ParallelBackend backend;
+      double mean_us, sigma_us, lowest_us, overhead_us;
+      size_t n_jets;
+    };
+    std::vector<BackendResult> results;
+    for (auto backend : backends) {
+      std::unique_ptr<ParallelLoop> loop;
+      try {
+        loop.reset(new ParallelLoop(backend, threads));
+      } catch (const std::invalid_argument& e) {
+        cerr << e.what() << endl;
+        exit(EXIT_FAILURE);
+      }
+      std::vector<std::vector<fastjet::PseudoJet>> decode_buffers(threads);
+      std::vector<size_t> n_jets(n_items);
+      auto body = [&](size_t item, int thread) {
+        auto ievt = first_event + item;
+        const std::vector<fastjet::PseudoJet>* input_particles;
+        if (compress_option->is_set()) {
+          event_store.decode_event(ievt, decode_buffers[thread]);
+          input_particles = &decode_buffers[thread];
+        } else {
+          input_particles = &events[ievt];
+        }
+        fastjet::ClusterSequence cluster_sequence(*input_particles, jet_def);
+        n_jets[item] = select_final_jets(cluster_sequence).size();
+      };
+
+      double total = 0.0, total2 = 0.0, lowest = 1.0e20;
+      for (long trial = 0; trial < trials; ++trial) {
+        auto start_t = std::chrono::steady_clock::now();
+        loop->run(n_items, body);
+        auto us_elapsed = chrono::duration<double, std::micro>(std::chrono::steady_clock::now() - start_t).count();
+        std::cout << "Trial " << trial << " (" << backend_name(backend) << ") " << us_elapsed << " us" << endl;
+        total += us_elapsed;
+        total2 += us_elapsed * us_elapsed;
+        lowest = std::min(lowest, us_elapsed);
+      }
+      total /= trials;
+      total2 /= trials;
+      double trial_sigma = trials > 1 ? std::sqrt(double(trials)/(trials-1) * (total2 - total*total)) : 0.0;
+      results.push_back({backend, total / n_items, trial_sigma / n_items, lowest / n_items,
+        loop->overhead_per_item(), std::accumulate(n_jets.begin(), n_jets.end(), size_t(0))});
+    }
+
+    std::cout << "Processed " << n_items << " events, " << trials << " times, with " << threads << " threads" << endl;
+    for (const auto& result : results) {
+      std::cout << "Backend " << backend_name(result.backend) << ": time per event " << result.mean_us << " +- " <<
+        result.sigma_us << " us (lowest " << result.lowest_us << " us), " << 1.0e6 / result.mean_us <<
+        " events/s, scheduling overhead " << result.overhead_us << " us per item, " << result.n_jets << " jets";
+      if (&result != &results.front()) {
+        std::cout << ", throughput x" << results.front().mean_us / result.mean_us << " relative to " <<
+          backend_name(results.front().backend);
+        if (result.n_jets != results.front().n_jets) std::cout << " (JET COUNT MISMATCH)";
+      }
+      std::cout << endl;
+    }
+    return 0;
+  }
+
   auto dump_fh = stdout;
   if (dump_option->is_set()) {
     if (dump_option->value() != "-") {
@@ -193,46 +821,208 @@ int main(int argc, char* argv[]) {
     }
   }
 
+#ifdef FASTJET_FINDER_HAVE_ARROW
+  std::unique_ptr<ArrowJetWriter> arrow_writer;
+  if (arrow_option->is_set()) {
+    if (arrow_batch_option->value() < 1) {
+      cerr << "Arrow record batches need at least one jet" << endl;
+      exit(EXIT_FAILURE);
+    }
+    arrow_writer.reset(new ArrowJetWriter(arrow_option->value(), arrow_constituents_option->is_set(),
+      arrow_batch_option->value()));
+    if (!arrow_writer->is_open()) exit(EXIT_FAILURE);
+  }
+#else
+  if (arrow_option->is_set()) {
+    cerr << "Arrow output requested, but fastjet-finder was built without Arrow support" << endl;
+    exit(EXIT_FAILURE);
+  }
+#endif
+
+  std::unique_ptr<JetImageWriter> image_writer;
+  if (images_option->is_set()) {
+    auto half_width = image_width_option->is_set() ? image_width_option->value() : R;
+    if (image_pixels_option->value() < 1 || half_width <= 0.0) {
+      cerr << "Jet image size and width must be positive" << endl;
+      exit(EXIT_FAILURE);
+    }
+    image_writer.reset(new JetImageWriter(images_option->value(), image_pixels_option->value(), half_width,
+      std::max(image_batch_option->value(), 1)));
+    if (!image_writer->is_open()) exit(EXIT_FAILURE);
+  }
+
+  std::unique_ptr<JetGraphWriter> graph_writer;
+  if ((graphs_option->is_set() || graph_compare_option->is_set()) && graph_k_option->value() < 1) {
+    cerr << "Jet graphs need at least one neighbour per constituent" << endl;
+    exit(EXIT_FAILURE);
+  }
+  if (graphs_option->is_set()) {
+    graph_writer.reset(new JetGraphWriter(graphs_option->value(), graph_k_option->value()));
+    if (!graph_writer->is_open()) exit(EXIT_FAILURE);
+  }
+
+  // Events after any skipped ones, for all per event times
+  const double n_output_events = std::max<size_t>(n_events - std::min<size_t>(skip_events, n_events), 1);
   double time_total = 0.0;
   double time_total2 = 0.0;
   double sigma = 0.0;
   double time_lowest = 1.0e20;
+  double time_decode = 0.0;
+  double time_stages = 0.0;
+  double time_constituents = 0.0;
+  double time_recursive_constituents = 0.0;
+  double time_images = 0.0;
+  double time_arrow = 0.0;
+  double time_graphs = 0.0;
+  double time_bucketed_graphs = 0.0;
+  double time_all_pairs_graphs = 0.0;
+  size_t graph_mismatches = 0;
+  size_t constituent_mismatches = 0;
+  // The constituent index is built for output only on the first trial,
+  // unless it is being timed
+  const bool output_constituents = (dump_option->is_set() && (dump_fields & kJetConstituentFields)) ||
+    arrow_option->is_set() || images_option->is_set() || graphs_option->is_set() || graph_compare_option->is_set();
+  JetConstituents jet_constituents;
+  std::vector<std::vector<fastjet::PseudoJet>> recursive_constituents;
+  std::vector<int> recursive_indices;
+  JetGraph bucketed_graph, all_pairs_graph;
+  // Lowest clustering time of each event over the trials, for slow event
+  // capture
+  std::vector<double> event_us;
+  std::vector<size_t> event_multiplicities;
+  if (slowest_option->is_set()) {
+    event_us.assign(n_events, 1.0e20);
+    event_multiplicities.assign(n_events, 0);
+  }
+  std::vector<fastjet::PseudoJet> decoded_event;
+  auto main_jet_definition = jet_definition(R);
   for (long trial = 0; trial < trials; ++trial) {
     std::cout << "Trial " << trial << " ";
+    double us_decode = 0.0;
+    double us_stages = 0.0;
+    double us_constituents = 0.0;
+    double us_images = 0.0;
+    double us_arrow = 0.0;
+    double us_graphs = 0.0;
     auto start_t = std::chrono::steady_clock::now();
-    for (size_t ievt = skip_events_option->value(); ievt < events.size(); ++ievt) {
-      auto cluster_sequence = run_fastjet_clustering(events[ievt], strategy, algorithm, recombine_scheme, R, power);
-
-      vector<fastjet::PseudoJet> final_jets;
-      if (ptmin_option->is_set()) {
-        final_jets = fastjet::sorted_by_pt(cluster_sequence.inclusive_jets(ptmin_option->value()));
-      } else if (dijmax_option->is_set()) {
-        cout << "dijmax: " << dijmax_option->value() << endl;
-        final_jets = fastjet::sorted_by_pt(cluster_sequence.inclusive_jets(ptmin_option->value()));
-        final_jets = fastjet::sorted_by_pt(cluster_sequence.exclusive_jets(dijmax_option->value()));
-      } else if (njets_option->is_set()) {
-        final_jets = fastjet::sorted_by_pt(cluster_sequence.exclusive_jets(njets_option->value()));
+    for (size_t ievt = skip_events_option->value(); ievt < n_events; ++ievt) {
+      const std::vector<fastjet::PseudoJet>* input_particles;
+      if (compress_option->is_set()) {
+        auto decode_start_t = std::chrono::steady_clock::now();
+        event_store.decode_event(ievt, decoded_event);
+        auto decode_stop_t = std::chrono::steady_clock::now();
+        us_decode += chrono::duration<double, std::micro>(decode_stop_t - decode_start_t).count();
+        input_particles = &decoded_event;
+      } else {
+        input_particles = &events[ievt];
+      }
+      if (!input_stages.empty()) {
+        staged_event = *input_particles;
+        us_stages += apply_input_stages(input_stages, ievt, staged_event);
+        input_particles = &staged_event;
       }
+      auto event_start_t = std::chrono::steady_clock::now();
+      auto cluster_sequence = run_fastjet_clustering(*input_particles, main_jet_definition);
 
-      if (dump_option->is_set() && trial==0) {
-         fprintf(dump_fh, "Jets in processed event %zu\n", ievt+1);
-    
-        // print out the details for each jet
-        for (unsigned int i = 0; i < final_jets.size(); i++) {
-          fprintf(dump_fh, "%5u %15.10f %15.10f %15.10f\n",
-          i, final_jets[i].rap(), final_jets[i].phi(),
-          final_jets[i].perp());
+      auto final_jets = select_final_jets(cluster_sequence);
+      if (slowest_option->is_set()) {
+        auto us_event = chrono::duration<double, std::micro>(std::chrono::steady_clock::now() - event_start_t).count();
+        event_us[ievt] = std::min(event_us[ievt], us_event);
+        event_multiplicities[ievt] = input_particles->size();
+      }
+
+      if (constituents_option->is_set() || (output_constituents && trial==0)) {
+        auto index_start_t = std::chrono::steady_clock::now();
+        build_jet_constituents(cluster_sequence, final_jets, jet_constituents);
+        auto index_stop_t = std::chrono::steady_clock::now();
+        auto us_index = chrono::duration<double, std::micro>(index_stop_t - index_start_t).count();
+        time_constituents += us_index;
+        us_constituents += us_index;
+        if (constituents_option->is_set()) {
+          // Same information from the recursive history walk, for comparison
+          recursive_constituents.resize(final_jets.size());
+          for (size_t ijet = 0; ijet < final_jets.size(); ++ijet) {
+            recursive_constituents[ijet] = final_jets[ijet].constituents();
+          }
+          auto recursive_stop_t = std::chrono::steady_clock::now();
+          auto us_recursive = chrono::duration<double, std::micro>(recursive_stop_t - index_stop_t).count();
+          time_recursive_constituents += us_recursive;
+          us_constituents += us_recursive;
+          // The same particles (by history index, which is the input index),
+          // not only the same number; the check itself is not timed
+          for (size_t ijet = 0; ijet < final_jets.size(); ++ijet) {
+            recursive_indices.clear();
+            for (const auto& constituent : recursive_constituents[ijet]) {
+              recursive_indices.push_back(constituent.cluster_hist_index());
+            }
+            std::sort(recursive_indices.begin(), recursive_indices.end());
+            if (!std::equal(recursive_indices.begin(), recursive_indices.end(), jet_constituents.begin(ijet),
+                            jet_constituents.end(ijet))) {
+              ++constituent_mismatches;
+            }
+          }
         }
+      }
+
+      if (dump_option->is_set() && trial==0) {
+        fprintf(dump_fh, "Jets in processed event %zu\n", ievt+1);
+        dump_jets(dump_fh, final_jets, dump_fields, &jet_constituents);
 
         // Dump the cluster sequence history content as well?
         if (debug_clusterseq_option->is_set()) {
           dump_clusterseq(cluster_sequence);
         }
       }
+
+      if (image_writer && trial==0) {
+        auto images_start_t = std::chrono::steady_clock::now();
+        image_writer->add_event(*input_particles, final_jets, jet_constituents);
+        us_images += chrono::duration<double, std::micro>(std::chrono::steady_clock::now() - images_start_t).count();
+      }
+
+      if (graph_writer && trial==0) {
+        auto graphs_start_t = std::chrono::steady_clock::now();
+        graph_writer->add_event(ievt+1, *input_particles, final_jets, jet_constituents);
+        us_graphs += chrono::duration<double, std::micro>(std::chrono::steady_clock::now() - graphs_start_t).count();
+      }
+
+      if (graph_compare_option->is_set() && trial==0) {
+        auto compare_start_t = std::chrono::steady_clock::now();
+        for (size_t ijet = 0; ijet < final_jets.size(); ++ijet) {
+          auto begin = jet_constituents.begin(ijet), end = jet_constituents.end(ijet);
+          auto bucketed_start_t = std::chrono::steady_clock::now();
+          build_knn_graph(final_jets[ijet], *input_particles, begin, end, graph_k_option->value(), bucketed_graph);
+          auto all_pairs_start_t = std::chrono::steady_clock::now();
+          build_knn_graph_all_pairs(final_jets[ijet], *input_particles, begin, end, graph_k_option->value(),
+            all_pairs_graph);
+          auto all_pairs_stop_t = std::chrono::steady_clock::now();
+          time_bucketed_graphs += chrono::duration<double, std::micro>(all_pairs_start_t - bucketed_start_t).count();
+          time_all_pairs_graphs += chrono::duration<double, std::micro>(all_pairs_stop_t - all_pairs_start_t).count();
+          if (!equivalent_knn_graphs(bucketed_graph, all_pairs_graph)) ++graph_mismatches;
+        }
+        us_graphs += chrono::duration<double, std::micro>(std::chrono::steady_clock::now() - compare_start_t).count();
+      }
+
+#ifdef FASTJET_FINDER_HAVE_ARROW
+      if (arrow_writer && trial==0) {
+        auto arrow_start_t = std::chrono::steady_clock::now();
+        arrow_writer->add_event(ievt+1, final_jets, jet_constituents);
+        us_arrow += chrono::duration<double, std::micro>(std::chrono::steady_clock::now() - arrow_start_t).count();
+      }
+#endif
     }
     auto stop_t = std::chrono::steady_clock::now();
     auto elapsed = stop_t - start_t;
     auto us_elapsed = double(chrono::duration_cast<chrono::microseconds>(elapsed).count());
+    // Decompression, pre-clustering stages, constituent indexing, jet
+    // images and graphs and Arrow output are reported separately from the
+    // clustering time
+    us_elapsed -= us_decode + us_stages + us_constituents + us_images + us_graphs + us_arrow;
+    time_images += us_images;
+    time_arrow += us_arrow;
+    time_graphs += us_graphs;
+    time_decode += us_decode;
+    time_stages += us_stages;
     std::cout << us_elapsed << " us" << endl;
     time_total += us_elapsed;
     time_total2 += us_elapsed*us_elapsed;
@@ -245,13 +1035,68 @@ int main(int argc, char* argv[]) {
   } else {
     sigma = 0.0;
   }
-  double mean_per_event = time_total / events.size();
-  double sigma_per_event = sigma / events.size();
-  time_lowest /= events.size();
-  std::cout << "Processed " << events.size() << " events, " << trials << " times" << endl;
+  double mean_per_event = time_total / n_output_events;
+  double sigma_per_event = sigma / n_output_events;
+  time_lowest /= n_output_events;
+  std::cout << "Processed " << n_events - std::min<size_t>(skip_events, n_events) << " events, " << trials <<
+    " times" << endl;
   std::cout << "Total time " << time_total << " us" << endl;
   std::cout << "Time per event " << mean_per_event << " +- " << sigma_per_event << " us" << endl;
   std::cout << "Lowest time per event " << time_lowest << " us" << endl;
+  if (compress_option->is_set()) {
+    std::cout << "Decompression time per event " << time_decode / trials / n_output_events << " us" << endl;
+  }
+  if (!input_stages.empty()) {
+    std::cout << "Pre-clustering time per event " << time_stages / trials / n_output_events << " us" << endl;
+    print_input_stage_summary(input_stages, std::cout);
+  }
+  if (slowest_option->is_set()) {
+    auto slowest = slowest_events(event_us, event_multiplicities, skip_events, slowest_option->value(),
+      slowest_per_particle_option->is_set());
+    std::cout << "Slowest events" << (slowest_per_particle_option->is_set() ? " per particle" : "") << ":" << endl;
+    for (const auto& slow : slowest) {
+      std::cout << "  event " << slow.event + 1 << " (event number " << event_numbers[slow.event] << ", " <<
+        slow.n_particles << " particles): " << slow.us << " us, " <<
+        slow.us / std::max<size_t>(slow.n_particles, 1) << " us per particle" << endl;
+    }
+    auto written = write_replay_file(input_file, slowest_file_option->value(), slowest);
+    if (written < 0) exit(EXIT_FAILURE);
+    std::cout << "Wrote " << written << " events to " << slowest_file_option->value() << endl;
+  }
+  if (constituents_option->is_set()) {
+    std::cout << "Constituent index time per event " << time_constituents / trials / n_output_events <<
+      " us, PseudoJet::constituents() time per event " << time_recursive_constituents / trials / n_output_events << " us";
+    if (constituent_mismatches) std::cout << " (" << constituent_mismatches << " CONSTITUENT MISMATCHES)";
+    std::cout << endl;
+  }
+
+  if (image_writer) {
+    if (!image_writer->close()) exit(EXIT_FAILURE);
+    std::cout << "Wrote " << image_writer->images_written() << " jet images to " << images_option->value() <<
+      " (" << time_images / n_output_events << " us per event)" << endl;
+  }
+
+  if (graph_writer) {
+    if (!graph_writer->close()) exit(EXIT_FAILURE);
+    std::cout << "Wrote " << graph_writer->graphs_written() << " jet graphs to " << graphs_option->value() << endl;
+  }
+  if (graph_writer || graph_compare_option->is_set()) {
+    std::cout << "Jet graph time per event " << time_graphs / n_output_events << " us" << endl;
+  }
+  if (graph_compare_option->is_set()) {
+    std::cout << "Bucketed jet graph time per event " << time_bucketed_graphs / n_output_events <<
+      " us, all pairs jet graph time per event " << time_all_pairs_graphs / n_output_events << " us";
+    if (graph_mismatches) std::cout << " (" << graph_mismatches << " JET GRAPH MISMATCHES)";
+    std::cout << endl;
+  }
+
+#ifdef FASTJET_FINDER_HAVE_ARROW
+  if (arrow_writer) {
+    if (!arrow_writer->close()) exit(EXIT_FAILURE);
+    std::cout << "Wrote " << arrow_writer->rows_written() << " jets to " << arrow_option->value() <<
+      " (" << time_arrow / n_output_events << " us per event)" << endl;
+  }
+#endif
 
   return 0;
 }
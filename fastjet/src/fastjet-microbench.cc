@@ -0,0 +1,242 @@
+// fastjet-microbench.cc
+// MIT Licenced, Copyright (c) 2024 CERN
+//
+// Google Benchmark microbenchmarks of the PseudoJet level operations
+// that fastjet-finder relies on, used to understand the fixed per-event
+// overhead that dominates timings for small (e.g., ee) events
+
+#include <cmath>
+#include <cstdlib>
+#include <iostream>
+#include <random>
+#include <string>
+#include <vector>
+
+#include <benchmark/benchmark.h>
+
+#include "fastjet/ClusterSequence.hh"
+#include "fastjet/PseudoJet.hh"
+
+#include "HepMC3/FourVector.h"
+
+#include "constituent-index.hh"
+#include "fastjet-utils.hh"
+
+namespace {
+
+// Generate a reproducible set of pion-like final state particles, roughly
+// matching the kinematics of the soft part of a pp event
+std::vector<HepMC3::FourVector> synthetic_momenta(size_t n, unsigned int seed = 42) {
+  std::mt19937 rng(seed);
+  std::exponential_distribution<double> pt_dist(1.0);
+  std::uniform_real_distribution<double> rap_dist(-4.0, 4.0);
+  std::uniform_real_distribution<double> phi_dist(0.0, fastjet::twopi);
+  const double mass = 0.13957;
+
+  std::vector<HepMC3::FourVector> momenta;
+  momenta.reserve(n);
+  for (size_t i = 0; i < n; ++i) {
+    auto pt = 0.1 + pt_dist(rng);
+    auto rap = rap_dist(rng);
+    auto phi = phi_dist(rng);
+    auto mt = std::sqrt(pt * pt + mass * mass);
+    momenta.emplace_back(pt * std::cos(phi), pt * std::sin(phi),
+                         mt * std::sinh(rap), mt * std::cosh(rap));
+  }
+  return momenta;
+}
+
+std::vector<fastjet::PseudoJet> synthetic_event(size_t n, unsigned int seed = 42) {
+  std::vector<fastjet::PseudoJet> particles;
+  particles.reserve(n);
+  for (const auto& p : synthetic_momenta(n, seed)) {
+    particles.emplace_back(p.px(), p.py(), p.pz(), p.e());
+  }
+  return particles;
+}
+
+fastjet::JetDefinition jet_definition_for(int64_t alg) {
+  // 0 = AntiKt R=0.4, 1 = EEKt R=0.4 p=1, 2 = Durham
+  if (alg == 1) {
+    return fastjet::JetDefinition(fastjet::ee_genkt_algorithm, 0.4, 1.0);
+  } else if (alg == 2) {
+    return fastjet::JetDefinition(fastjet::ee_kt_algorithm);
+  }
+  return fastjet::JetDefinition(fastjet::antikt_algorithm, 0.4);
+}
+
+const char* jet_definition_label(int64_t alg) {
+  if (alg == 1) return "EEKt";
+  if (alg == 2) return "Durham";
+  return "AntiKt";
+}
+
+}  // namespace
+
+// Construction of PseudoJets from HepMC3 momenta, as done by read_input_events
+static void BM_PseudoJetFromHepMC3(benchmark::State& state) {
+  auto momenta = synthetic_momenta(state.range(0));
+  std::vector<fastjet::PseudoJet> particles;
+  for (auto _ : state) {
+    particles.clear();
+    particles.reserve(momenta.size());
+    for (const auto& p : momenta) {
+      particles.emplace_back(p.px(), p.py(), p.pz(), p.e());
+    }
+    benchmark::DoNotOptimize(particles.data());
+    benchmark::ClobberMemory();
+  }
+  state.SetItemsProcessed(state.iterations() * state.range(0));
+}
+BENCHMARK(BM_PseudoJetFromHepMC3)->Arg(64)->Arg(512);
+
+// rap/phi/perp on freshly constructed PseudoJets (rapidity and phi are
+// cached after the first call, so each iteration uses a new copy)
+static void BM_PseudoJetKinematics(benchmark::State& state) {
+  auto particles = synthetic_event(state.range(0));
+  for (auto _ : state) {
+    double sum = 0.0;
+    for (const auto& p : particles) {
+      fastjet::PseudoJet fresh(p.px(), p.py(), p.pz(), p.E());
+      sum += fresh.rap() + fresh.phi() + fresh.perp();
+    }
+    benchmark::DoNotOptimize(sum);
+  }
+  state.SetItemsProcessed(state.iterations() * state.range(0));
+}
+BENCHMARK(BM_PseudoJetKinematics)->Arg(64)->Arg(512);
+
+// Pairwise recombination with each of the standard schemes; E_scheme is
+// the plain operator+
+static void BM_Recombine(benchmark::State& state) {
+  auto scheme = static_cast<fastjet::RecombinationScheme>(state.range(0));
+  fastjet::JetDefinition::DefaultRecombiner recombiner(scheme);
+  auto particles = synthetic_event(512);
+  for (auto& p : particles) recombiner.preprocess(p);
+  fastjet::PseudoJet merged;
+  for (auto _ : state) {
+    for (size_t i = 1; i < particles.size(); ++i) {
+      recombiner.recombine(particles[i - 1], particles[i], merged);
+      benchmark::DoNotOptimize(merged);
+    }
+  }
+  state.SetItemsProcessed(state.iterations() * (particles.size() - 1));
+  state.SetLabel(scheme == fastjet::E_scheme    ? "E_scheme"
+                 : scheme == fastjet::pt_scheme ? "pt_scheme"
+                                                : "pt2_scheme");
+}
+BENCHMARK(BM_Recombine)
+    ->Arg(fastjet::E_scheme)
+    ->Arg(fastjet::pt_scheme)
+    ->Arg(fastjet::pt2_scheme);
+
+// sorted_by_pt over typical final jet multiplicities
+static void BM_SortedByPt(benchmark::State& state) {
+  auto jets = synthetic_event(state.range(0));
+  for (auto _ : state) {
+    auto sorted = fastjet::sorted_by_pt(jets);
+    benchmark::DoNotOptimize(sorted.data());
+  }
+  state.SetItemsProcessed(state.iterations() * state.range(0));
+}
+BENCHMARK(BM_SortedByPt)->RangeMultiplier(4)->Range(4, 256);
+
+// Final jet extraction from an existing cluster sequence
+static void BM_InclusiveJets(benchmark::State& state) {
+  auto particles = synthetic_event(state.range(0));
+  fastjet::ClusterSequence cs(particles, jet_definition_for(0));
+  for (auto _ : state) {
+    auto jets = cs.inclusive_jets(5.0);
+    benchmark::DoNotOptimize(jets.data());
+  }
+}
+BENCHMARK(BM_InclusiveJets)->Arg(64)->Arg(512);
+
+static void BM_ExclusiveJets(benchmark::State& state) {
+  auto particles = synthetic_event(state.range(0));
+  fastjet::ClusterSequence cs(particles, jet_definition_for(2));
+  for (auto _ : state) {
+    auto jets = cs.exclusive_jets(4);
+    benchmark::DoNotOptimize(jets.data());
+  }
+}
+BENCHMARK(BM_ExclusiveJets)->Arg(64)->Arg(512);
+
+// Constituents of every final jet, from the recursive history walk of
+// PseudoJet::constituents() and from the flat constituent index
+static void BM_JetConstituents(benchmark::State& state) {
+  auto particles = synthetic_event(state.range(0));
+  fastjet::ClusterSequence cs(particles, jet_definition_for(0));
+  auto jets = cs.inclusive_jets(0.0);
+  for (auto _ : state) {
+    for (const auto& jet : jets) {
+      auto constituents = jet.constituents();
+      benchmark::DoNotOptimize(constituents.data());
+    }
+  }
+}
+BENCHMARK(BM_JetConstituents)->Arg(64)->Arg(512);
+
+static void BM_ConstituentIndex(benchmark::State& state) {
+  auto particles = synthetic_event(state.range(0));
+  fastjet::ClusterSequence cs(particles, jet_definition_for(0));
+  auto jets = cs.inclusive_jets(0.0);
+  JetConstituents constituents;
+  for (auto _ : state) {
+    build_jet_constituents(cs, jets, constituents);
+    benchmark::DoNotOptimize(constituents.indices.data());
+  }
+}
+BENCHMARK(BM_ConstituentIndex)->Arg(64)->Arg(512);
+
+// ClusterSequence construction and clustering on tiny events, where the
+// fixed overhead (jet definition setup, strategy choice, allocation) is
+// comparable to the clustering work itself
+static void BM_ClusterSequence(benchmark::State& state) {
+  auto particles = synthetic_event(state.range(1));
+  auto jet_def = jet_definition_for(state.range(0));
+  for (auto _ : state) {
+    fastjet::ClusterSequence cs(particles, jet_def);
+    benchmark::DoNotOptimize(cs.history().data());
+  }
+  state.SetLabel(jet_definition_label(state.range(0)));
+  state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK(BM_ClusterSequence)
+    ->ArgsProduct({{0, 1, 2}, benchmark::CreateRange(2, 128, 4)});
+
+// Clustering over real events, registered when an input file is given
+static void BM_ClusterSequenceFile(benchmark::State& state,
+                                   const std::vector<std::vector<fastjet::PseudoJet>>* events,
+                                   int64_t alg) {
+  auto jet_def = jet_definition_for(alg);
+  for (auto _ : state) {
+    for (const auto& event : *events) {
+      fastjet::ClusterSequence cs(event, jet_def);
+      benchmark::DoNotOptimize(cs.history().data());
+    }
+  }
+  state.SetItemsProcessed(state.iterations() * events->size());
+}
+
+int main(int argc, char** argv) {
+  benchmark::Initialize(&argc, argv);
+
+  // Any remaining argument is taken as a HepMC3 input file
+  std::vector<std::vector<fastjet::PseudoJet>> events;
+  if (argc > 2) {
+    std::cerr << "Only one <HepMC3_input_file> supported" << std::endl;
+    return EXIT_FAILURE;
+  } else if (argc == 2) {
+    events = read_input_events(argv[1]);
+    for (int64_t alg = 0; alg < 3; ++alg) {
+      benchmark::RegisterBenchmark(
+          (std::string("BM_ClusterSequenceFile/") + jet_definition_label(alg)).c_str(),
+          BM_ClusterSequenceFile, &events, alg);
+    }
+  }
+
+  benchmark::RunSpecifiedBenchmarks();
+  benchmark::Shutdown();
+  return 0;
+}
@@ -21,23 +21,19 @@
 #include "HepMC3/GenParticle.h"
 #include "HepMC3/ReaderAscii.h"
 
+#include "fastjet-utils.hh"
+
 using namespace std;
 
-vector<vector<fastjet::PseudoJet>> read_input_events(const char* fname, long maxevents = -1) {
-  // Read input events from a HepMC3 file, return the events in a vector
-  // Each event is a vector of initial particles
-  
-  HepMC3::ReaderAscii input_file (fname);
+namespace {
 
-  int events_parsed = 0;
-
-  std::vector<std::vector<fastjet::PseudoJet>> events;
+long for_each_reader_event(HepMC3::ReaderAscii& input_file, long maxevents,
+                           const std::function<void(const HepMC3::GenEvent&)>& process) {
+  long events_parsed = 0;
 
   while(!input_file.failed()) {
     if (maxevents >= 0 && events_parsed >= maxevents) break;
 
-    std::vector<fastjet::PseudoJet> input_particles;
-
     HepMC3::GenEvent evt(HepMC3::Units::GEV, HepMC3::Units::MM);
 
     // Read event from input file
@@ -47,19 +43,50 @@ vector<vector<fastjet::PseudoJet>> read_input_events(const char* fname, long max
     if (input_file.failed()) break;
 
     ++events_parsed;
-    input_particles.clear();
-    input_particles.reserve(evt.particles().size());
-    for(auto p: evt.particles()){
-      if(p->status() == 1){
-	      input_particles.emplace_back(p->momentum().px(),
-				     p->momentum().py(),
-				     p->momentum().pz(),
-				     p->momentum().e());
-      }
+    process(evt);
+  }
+
+  return events_parsed;
+}
+
+}
+
+long for_each_input_event(const char* fname, long maxevents,
+                          const std::function<void(const HepMC3::GenEvent&)>& process) {
+  HepMC3::ReaderAscii input_file (fname);
+  return for_each_reader_event(input_file, maxevents, process);
+}
+
+long for_each_input_event(std::istream& input, long maxevents,
+                          const std::function<void(const HepMC3::GenEvent&)>& process) {
+  HepMC3::ReaderAscii input_file (input);
+  return for_each_reader_event(input_file, maxevents, process);
+}
+
+vector<fastjet::PseudoJet> final_state_particles(const HepMC3::GenEvent& evt) {
+  std::vector<fastjet::PseudoJet> input_particles;
+  input_particles.reserve(evt.particles().size());
+  for(auto p: evt.particles()){
+    if(p->status() == 1){
+      input_particles.emplace_back(p->momentum().px(),
+                                   p->momentum().py(),
+                                   p->momentum().pz(),
+                                   p->momentum().e());
+      input_particles.back().set_user_index(input_particles.size() - 1);
     }
-    events.push_back(input_particles);
   }
+  return input_particles;
+}
+
+vector<vector<fastjet::PseudoJet>> read_input_events(const char* fname, long maxevents) {
+  // Read input events from a HepMC3 file, return the events in a vector
+  // Each event is a vector of initial particles
+  std::vector<std::vector<fastjet::PseudoJet>> events;
+
+  auto events_parsed = for_each_input_event(fname, maxevents, [&](const HepMC3::GenEvent& evt) {
+    events.push_back(final_state_particles(evt));
+  });
 
   cout << "Read " << events_parsed << " events from " << fname << endl;
   return events;
-}
\ No newline at end of file
+}
@@ -1,4 +1,20 @@
 #include "fastjet/ClusterSequence.hh"
+#include "HepMC3/GenEvent.h"
+#include <functional>
+#include <istream>
 #include <vector>
 
 std::vector<std::vector<fastjet::PseudoJet>> read_input_events(const char* fname, long maxevents = -1);
+
+// Call process for each event read from a HepMC3 file, without keeping the
+// events in memory; returns the number of events read
+long for_each_input_event(const char* fname, long maxevents,
+                          const std::function<void(const HepMC3::GenEvent&)>& process);
+
+// As above, reading the HepMC3 events from a stream
+long for_each_input_event(std::istream& input, long maxevents,
+                          const std::function<void(const HepMC3::GenEvent&)>& process);
+
+// Final state (status 1) particles of an event, in record order, with the
+// user index set to the index in the returned vector
+std::vector<fastjet::PseudoJet> final_state_particles(const HepMC3::GenEvent& evt);
@@ -0,0 +1,135 @@
+// flavour.cc
+// MIT Licenced, Copyright (c) 2024 CERN
+//
+// Jet flavour labelling by ghost association of the b and c hadrons of
+// the generator record, and a benchmark of its cost
+
+#include <algorithm>
+#include <chrono>
+#include <cstdlib>
+#include <iostream>
+
+#include "HepMC3/GenParticle.h"
+#include "HepMC3/GenVertex.h"
+
+#include "flavour.hh"
+
+using namespace std;
+
+int hadron_flavour(int pdg_id) {
+  // Hadron codes are n nr nL nq1 nq2 nq3 nJ; mesons have nq1 = 0, and
+  // quarks, leptons and diquarks have nq3 = 0. Nuclei and other codes of
+  // 7 digits or more are not hadrons here.
+  auto id = std::abs(pdg_id);
+  if (id >= 1000000) return 0;
+  auto quarks = id % 10000 / 10;
+  if (quarks < 10 || quarks % 10 == 0) return 0;
+  int flavour = 0;
+  for (; quarks > 0; quarks /= 10) {
+    auto q = quarks % 10;
+    if (q == 5) return 5;
+    if (q == 4) flavour = 4;
+  }
+  return flavour;
+}
+
+std::vector<fastjet::PseudoJet> heavy_flavour_hadrons(const HepMC3::GenEvent& evt) {
+  std::vector<fastjet::PseudoJet> hadrons;
+  for (auto p : evt.particles()) {
+    auto flavour = hadron_flavour(p->pid());
+    if (flavour == 0) continue;
+    bool weakly_decaying = true;
+    if (auto end_vertex = p->end_vertex()) {
+      for (auto daughter : end_vertex->particles_out()) {
+        if (hadron_flavour(daughter->pid()) == flavour) {
+          weakly_decaying = false;
+          break;
+        }
+      }
+    }
+    if (!weakly_decaying) continue;
+    hadrons.emplace_back(p->momentum().px(), p->momentum().py(), p->momentum().pz(), p->momentum().e());
+    hadrons.back().set_user_index(flavour);
+  }
+  return hadrons;
+}
+
+void add_flavour_ghosts(std::vector<fastjet::PseudoJet>& particles, const std::vector<fastjet::PseudoJet>& hadrons) {
+  particles.reserve(particles.size() + hadrons.size());
+  for (const auto& hadron : hadrons) {
+    particles.push_back(hadron * kGhostScale);
+    particles.back().set_user_index(particles.size() - 1);
+  }
+}
+
+std::vector<int> ghost_flavour_labels(const JetConstituents& constituents, size_t n_particles,
+                                      const std::vector<fastjet::PseudoJet>& hadrons) {
+  std::vector<int> labels(constituents.n_jets(), 0);
+  for (size_t ijet = 0; ijet < constituents.n_jets(); ++ijet) {
+    // Constituents are in increasing order, so the ghosts come last
+    for (auto it = constituents.end(ijet); it != constituents.begin(ijet) && size_t(*(it - 1)) >= n_particles; --it) {
+      labels[ijet] = std::max(labels[ijet], hadrons[*(it - 1) - n_particles].user_index());
+    }
+  }
+  return labels;
+}
+
+void run_flavour_benchmark(int trials, size_t first_event, size_t n_events,
+                           const std::function<const std::vector<fastjet::PseudoJet>&(size_t)>& get_event,
+                           const std::vector<std::vector<fastjet::PseudoJet>>& hadrons,
+                           const fastjet::JetDefinition& jet_def,
+                           const std::function<std::vector<fastjet::PseudoJet>(const fastjet::ClusterSequence&)>& select_jets) {
+  using clock = std::chrono::steady_clock;
+
+  double time_plain = 0.0, time_ghosts = 0.0, time_labels = 0.0;
+  size_t n_hadrons[6] = {0}, n_labelled[6] = {0};
+  size_t n_jets = 0, n_changed_events = 0;
+
+  std::vector<fastjet::PseudoJet> ghosted_particles;
+  JetConstituents constituents;
+  for (int trial = 0; trial < trials; ++trial) {
+    for (size_t ievt = first_event; ievt < n_events; ++ievt) {
+      const auto& particles = get_event(ievt);
+
+      auto start_t = clock::now();
+      fastjet::ClusterSequence plain_cs(particles, jet_def);
+      auto plain_jets = select_jets(plain_cs);
+      auto plain_t = clock::now();
+      ghosted_particles = particles;
+      add_flavour_ghosts(ghosted_particles, hadrons[ievt]);
+      fastjet::ClusterSequence ghosted_cs(ghosted_particles, jet_def);
+      auto ghosted_jets = select_jets(ghosted_cs);
+      auto ghosts_t = clock::now();
+      build_jet_constituents(ghosted_cs, ghosted_jets, constituents);
+      auto labels = ghost_flavour_labels(constituents, particles.size(), hadrons[ievt]);
+      auto labels_t = clock::now();
+
+      time_plain += std::chrono::duration<double, std::micro>(plain_t - start_t).count();
+      time_ghosts += std::chrono::duration<double, std::micro>(ghosts_t - plain_t).count();
+      time_labels += std::chrono::duration<double, std::micro>(labels_t - ghosts_t).count();
+
+      if (trial > 0) continue;
+      for (const auto& hadron : hadrons[ievt]) ++n_hadrons[hadron.user_index()];
+      for (auto label : labels) ++n_labelled[label];
+      n_jets += ghosted_jets.size();
+      if (ghosted_jets.size() != plain_jets.size()) ++n_changed_events;
+    }
+  }
+
+  const auto n_counted = double(std::max(n_events, first_event + 1) - first_event);
+  const auto n_timed = n_counted * trials;
+  cout << "Ghost flavour labelling" << endl;
+  cout << "Heavy flavour hadrons per event: b " << n_hadrons[5] / n_counted << ", c "
+       << n_hadrons[4] / n_counted << endl;
+  cout << "Plain clustering time per event " << time_plain / n_timed << " us" << endl;
+  cout << "Clustering with ghosts time per event " << time_ghosts / n_timed << " us" << endl;
+  cout << "Labelling time per event " << time_labels / n_timed << " us" << endl;
+  auto overhead = time_ghosts + time_labels - time_plain;
+  cout << "Flavour labelling overhead per event " << overhead / n_timed << " us (" << 100.0 * overhead / time_plain
+       << "% of plain clustering)" << endl;
+  cout << "Jets: " << n_jets << " (b " << n_labelled[5] << ", c " << n_labelled[4] << ", light " << n_labelled[0]
+       << ")" << endl;
+  if (n_changed_events > 0) {
+    cout << "Warning: ghosts changed the number of jets in " << n_changed_events << " events" << endl;
+  }
+}
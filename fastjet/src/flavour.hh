@@ -0,0 +1,53 @@
+// flavour.hh
+// MIT Licenced, Copyright (c) 2024 CERN
+//
+// Jet flavour labelling by ghost association of the b and c hadrons of
+// the generator record, and a benchmark of its cost
+
+#ifndef FLAVOUR_HH
+#define FLAVOUR_HH
+
+#include <functional>
+#include <vector>
+
+#include "fastjet/ClusterSequence.hh"
+#include "fastjet/PseudoJet.hh"
+
+#include "HepMC3/GenEvent.h"
+
+#include "constituent-index.hh"
+
+// Factor applied to the hadron momenta to make ghosts, small enough not to
+// change the jets
+constexpr double kGhostScale = 1.0e-18;
+
+// Heaviest quark flavour of a hadron: 5 (b), 4 (c) or 0 (light, or not a
+// hadron)
+int hadron_flavour(int pdg_id);
+
+// The weakly decaying b and c hadrons of an event (those with no daughter
+// of the same flavour), in record order, with the user index set to the
+// flavour (5 or 4)
+std::vector<fastjet::PseudoJet> heavy_flavour_hadrons(const HepMC3::GenEvent& evt);
+
+// Append the hadrons to the particles as ghosts, with momenta scaled by
+// kGhostScale and the user index set to their position
+void add_flavour_ghosts(std::vector<fastjet::PseudoJet>& particles, const std::vector<fastjet::PseudoJet>& hadrons);
+
+// Flavour label of each jet: 5 if it has a b hadron ghost, otherwise 4 if
+// it has a c hadron ghost, otherwise 0. Ghosts are the inputs from
+// n_particles on, in the order of hadrons.
+std::vector<int> ghost_flavour_labels(const JetConstituents& constituents, size_t n_particles,
+                                      const std::vector<fastjet::PseudoJet>& hadrons);
+
+// For events first_event..n_events-1, time plain clustering against
+// clustering with the hadrons of each event added as ghosts, followed by
+// labelling of the final jets (from select_jets), and report the overhead
+// and the numbers of b, c and light jets
+void run_flavour_benchmark(int trials, size_t first_event, size_t n_events,
+                           const std::function<const std::vector<fastjet::PseudoJet>&(size_t)>& get_event,
+                           const std::vector<std::vector<fastjet::PseudoJet>>& hadrons,
+                           const fastjet::JetDefinition& jet_def,
+                           const std::function<std::vector<fastjet::PseudoJet>(const fastjet::ClusterSequence&)>& select_jets);
+
+#endif
@@ -0,0 +1,37 @@
+// input-stages.cc
+// MIT Licenced, Copyright (c) 2024 CERN
+//
+// Optional pre-clustering stages that transform the input particles of
+// each event (e.g., pileup mitigation), timed separately from clustering
+
+#include <chrono>
+
+#include "input-stages.hh"
+
+double apply_input_stages(std::vector<InputStage>& stages, size_t ievt,
+                          std::vector<fastjet::PseudoJet>& particles) {
+  double total_us = 0.0;
+  for (auto& stage : stages) {
+    stage.n_in += particles.size();
+    auto start_t = std::chrono::steady_clock::now();
+    stage.apply(ievt, particles);
+    auto stop_t = std::chrono::steady_clock::now();
+    auto us = std::chrono::duration<double, std::micro>(stop_t - start_t).count();
+    stage.time_us += us;
+    stage.n_out += particles.size();
+    ++stage.n_calls;
+    total_us += us;
+  }
+  return total_us;
+}
+
+void print_input_stage_summary(const std::vector<InputStage>& stages, std::ostream& out) {
+  for (const auto& stage : stages) {
+    if (stage.n_calls == 0) continue;
+    out << "Stage " << stage.name << ": " << stage.time_us / stage.n_calls << " us per event, "
+        << double(stage.n_in) / stage.n_calls << " -> " << double(stage.n_out) / stage.n_calls
+        << " particles per event";
+    if (stage.n_out > 0) out << ", reduction factor " << double(stage.n_in) / stage.n_out;
+    out << std::endl;
+  }
+}
@@ -0,0 +1,36 @@
+// input-stages.hh
+// MIT Licenced, Copyright (c) 2024 CERN
+//
+// Optional pre-clustering stages that transform the input particles of
+// each event (e.g., pileup mitigation), timed separately from clustering
+
+#ifndef INPUT_STAGES_HH
+#define INPUT_STAGES_HH
+
+#include <functional>
+#include <ostream>
+#include <string>
+#include <vector>
+
+#include "fastjet/PseudoJet.hh"
+
+struct InputStage {
+  std::string name;
+  // Transform the particles of event ievt in place
+  std::function<void(size_t ievt, std::vector<fastjet::PseudoJet>& particles)> apply;
+
+  // Accumulated statistics
+  double time_us = 0.0;
+  size_t n_calls = 0;
+  size_t n_in = 0;
+  size_t n_out = 0;
+};
+
+// Run each stage in turn, accumulating timing and multiplicity statistics;
+// returns the total time taken in us
+double apply_input_stages(std::vector<InputStage>& stages, size_t ievt,
+                          std::vector<fastjet::PseudoJet>& particles);
+
+void print_input_stage_summary(const std::vector<InputStage>& stages, std::ostream& out);
+
+#endif
@@ -0,0 +1,240 @@
+// jet-graphs.cc
+// MIT Licenced, Copyright (c) 2024 CERN
+//
+// k-nearest-neighbour graphs of the constituents of selected jets in
+// (delta eta, delta phi), for point cloud and graph network taggers,
+// written to a compact binary file
+
+#include <algorithm>
+#include <cmath>
+#include <iostream>
+#include <utility>
+
+#include "jet-graphs.hh"
+
+using namespace std;
+
+namespace {
+
+// Fill the node features of graph and the node coordinates x (delta eta)
+// and y (delta phi); returns the number of neighbours per node
+int fill_nodes(const fastjet::PseudoJet& jet, const std::vector<fastjet::PseudoJet>& particles,
+               const int* begin, const int* end, int k, JetGraph& graph,
+               std::vector<double>& x, std::vector<double>& y) {
+  const auto n = size_t(end - begin);
+  graph.features.resize(n * kGraphFeatures);
+  x.resize(n);
+  y.resize(n);
+  const auto jet_eta = jet.eta();
+  const auto jet_phi = jet.phi();
+  const auto jet_pt = jet.pt() > 0.0 ? jet.pt() : 1.0;
+  const auto jet_E = jet.E() > 0.0 ? jet.E() : 1.0;
+  for (size_t i = 0; i < n; ++i) {
+    const auto& p = particles[begin[i]];
+    x[i] = y[i] = 0.0;
+    if (p.pt2() > 0.0) {
+      x[i] = p.eta() - jet_eta;
+      auto dphi = p.phi() - jet_phi;
+      if (dphi > fastjet::pi) dphi -= fastjet::twopi;
+      if (dphi < -fastjet::pi) dphi += fastjet::twopi;
+      y[i] = dphi;
+    }
+    auto features = graph.features.data() + i * kGraphFeatures;
+    features[0] = float(x[i]);
+    features[1] = float(y[i]);
+    features[2] = float(p.pt() / jet_pt);
+    features[3] = float(p.E() / jet_E);
+  }
+  graph.n_neighbours = std::max(0, std::min<int>(k, int(n) - 1));
+  graph.neighbours.resize(n * graph.n_neighbours);
+  return graph.n_neighbours;
+}
+
+// Neighbour candidates are ordered by squared distance, then index, so
+// that both searches give the same neighbours
+using Candidate = std::pair<double, uint32_t>;
+
+void all_pairs_neighbours(const std::vector<double>& x, const std::vector<double>& y, int kk, JetGraph& graph) {
+  const auto n = x.size();
+  thread_local std::vector<Candidate> candidates;
+  for (size_t i = 0; i < n; ++i) {
+    candidates.clear();
+    for (size_t j = 0; j < n; ++j) {
+      if (j == i) continue;
+      auto dx = x[i] - x[j], dy = y[i] - y[j];
+      candidates.emplace_back(dx * dx + dy * dy, j);
+    }
+    std::partial_sort(candidates.begin(), candidates.begin() + kk, candidates.end());
+    for (int j = 0; j < kk; ++j) graph.neighbours[i * kk + j] = candidates[j].second;
+  }
+}
+
+}  // namespace
+
+void build_knn_graph(const fastjet::PseudoJet& jet, const std::vector<fastjet::PseudoJet>& particles,
+                     const int* begin, const int* end, int k, JetGraph& graph) {
+  thread_local std::vector<double> x, y;
+  auto kk = fill_nodes(jet, particles, begin, end, k, graph, x, y);
+  if (kk == 0) return;
+  const auto n = x.size();
+  // Small jets are quicker without the grid
+  if (n < 2 * size_t(kk) + 16) {
+    all_pairs_neighbours(x, y, kk, graph);
+    return;
+  }
+
+  // Grid over the bounding box. Constituents are concentrated around the
+  // jet axis, so the cell size is set for about k nodes per cell at the
+  // density of a Gaussian with the spread of the nodes,
+  // n / (2 pi sigma_x sigma_y), rather than the mean density over the box.
+  auto [xmin_it, xmax_it] = std::minmax_element(x.begin(), x.end());
+  auto [ymin_it, ymax_it] = std::minmax_element(y.begin(), y.end());
+  const auto xmin = *xmin_it, ymin = *ymin_it;
+  const auto wx = *xmax_it - xmin, wy = *ymax_it - ymin;
+  double sx = 0.0, sy = 0.0, sxx = 0.0, syy = 0.0;
+  for (size_t i = 0; i < n; ++i) {
+    sx += x[i];
+    sy += y[i];
+    sxx += x[i] * x[i];
+    syy += y[i] * y[i];
+  }
+  const auto sigma_x = std::sqrt(std::max(sxx / n - (sx / n) * (sx / n), 0.0));
+  const auto sigma_y = std::sqrt(std::max(syy / n - (sy / n) * (sy / n), 0.0));
+  auto h = std::sqrt(fastjet::twopi * sigma_x * sigma_y * kk / n);
+  if (!(h > 0.0)) h = std::max(wx, wy) * kk / n;
+  if (!(h > 0.0)) h = 1.0;
+  const auto nx = int(std::min<double>(wx / h + 1.0, n));
+  const auto ny = int(std::min<double>(wy / h + 1.0, n));
+  const auto cw = std::max(wx / nx, 1.0e-12);
+  const auto ch = std::max(wy / ny, 1.0e-12);
+
+  // Nodes sorted by cell (counting sort)
+  thread_local std::vector<int> cell_of, cell_start;
+  thread_local std::vector<uint32_t> cell_nodes;
+  cell_of.resize(n);
+  cell_start.assign(nx * ny + 1, 0);
+  cell_nodes.resize(n);
+  for (size_t i = 0; i < n; ++i) {
+    auto ix = std::min(int((x[i] - xmin) / cw), nx - 1);
+    auto iy = std::min(int((y[i] - ymin) / ch), ny - 1);
+    cell_of[i] = iy * nx + ix;
+    ++cell_start[cell_of[i] + 1];
+  }
+  for (int c = 0; c < nx * ny; ++c) cell_start[c + 1] += cell_start[c];
+  for (size_t i = 0; i < n; ++i) cell_nodes[cell_start[cell_of[i]]++] = i;
+  for (int c = nx * ny; c > 0; --c) cell_start[c] = cell_start[c - 1];
+  cell_start[0] = 0;
+
+  thread_local std::vector<Candidate> heap;
+  for (size_t i = 0; i < n; ++i) {
+    heap.clear();
+    auto visit = [&](int cell) {
+      for (auto it = cell_start[cell]; it < cell_start[cell + 1]; ++it) {
+        auto j = cell_nodes[it];
+        if (j == i) continue;
+        auto dx = x[i] - x[j], dy = y[i] - y[j];
+        Candidate candidate{dx * dx + dy * dy, j};
+        if (int(heap.size()) < kk) {
+          heap.push_back(candidate);
+          std::push_heap(heap.begin(), heap.end());
+        } else if (candidate < heap.front()) {
+          std::pop_heap(heap.begin(), heap.end());
+          heap.back() = candidate;
+          std::push_heap(heap.begin(), heap.end());
+        }
+      }
+    };
+
+    // Rings of cells at increasing Chebyshev distance r from the node's
+    // cell; after each ring, nodes not yet visited are at least as far
+    // away as the nearest edge of the visited block not on the grid edge
+    const auto cx = cell_of[i] % nx, cy = cell_of[i] / nx;
+    for (int r = 0;; ++r) {
+      for (int iy = std::max(cy - r, 0); iy <= std::min(cy + r, ny - 1); ++iy) {
+        auto edge_row = iy == cy - r || iy == cy + r;
+        for (int ix = std::max(cx - r, 0); ix <= std::min(cx + r, nx - 1); ++ix) {
+          if (edge_row || ix == cx - r || ix == cx + r) visit(iy * nx + ix);
+          else ix = std::max(ix, std::min(cx + r, nx - 1) - 1);
+        }
+      }
+      auto edge = 1.0e300;
+      if (cx - r > 0) edge = std::min(edge, x[i] - (xmin + (cx - r) * cw));
+      if (cx + r < nx - 1) edge = std::min(edge, xmin + (cx + r + 1) * cw - x[i]);
+      if (cy - r > 0) edge = std::min(edge, y[i] - (ymin + (cy - r) * ch));
+      if (cy + r < ny - 1) edge = std::min(edge, ymin + (cy + r + 1) * ch - y[i]);
+      if (edge == 1.0e300) break;
+      if (int(heap.size()) == kk && heap.front().first < edge * edge) break;
+    }
+
+    std::sort_heap(heap.begin(), heap.end());
+    for (int j = 0; j < kk; ++j) graph.neighbours[i * kk + j] = heap[j].second;
+  }
+}
+
+void build_knn_graph_all_pairs(const fastjet::PseudoJet& jet, const std::vector<fastjet::PseudoJet>& particles,
+                               const int* begin, const int* end, int k, JetGraph& graph) {
+  thread_local std::vector<double> x, y;
+  auto kk = fill_nodes(jet, particles, begin, end, k, graph, x, y);
+  if (kk > 0) all_pairs_neighbours(x, y, kk, graph);
+}
+
+bool equivalent_knn_graphs(const JetGraph& a, const JetGraph& b) {
+  if (a.features != b.features || a.n_neighbours != b.n_neighbours) return false;
+  auto distance2 = [](const JetGraph& graph, size_t i, size_t j) {
+    auto dx = graph.features[i * kGraphFeatures] - graph.features[j * kGraphFeatures];
+    auto dy = graph.features[i * kGraphFeatures + 1] - graph.features[j * kGraphFeatures + 1];
+    return dx * dx + dy * dy;
+  };
+  for (size_t i = 0; i < a.n_nodes(); ++i) {
+    for (int j = 0; j < a.n_neighbours; ++j) {
+      auto ja = a.neighbours[i * a.n_neighbours + j], jb = b.neighbours[i * b.n_neighbours + j];
+      if (ja != jb && distance2(a, i, ja) != distance2(b, i, jb)) return false;
+    }
+  }
+  return true;
+}
+
+JetGraphWriter::JetGraphWriter(const std::string& filename, int k) : m_k(k) {
+  m_file = fopen(filename.c_str(), "wb");
+  if (!m_file) {
+    cerr << "Failed to open jet graph file " << filename << endl;
+    return;
+  }
+  write("JETGRAPH", 8);
+  const uint32_t header[3] = {1, kGraphFeatures, uint32_t(k)};
+  write(header, sizeof(header));
+}
+
+JetGraphWriter::~JetGraphWriter() {
+  if (m_file) close();
+}
+
+void JetGraphWriter::write(const void* data, size_t size) {
+  if (size > 0 && fwrite(data, 1, size, m_file) != size) m_ok = false;
+}
+
+void JetGraphWriter::add_event(size_t event, const std::vector<fastjet::PseudoJet>& particles,
+                               const std::vector<fastjet::PseudoJet>& jets, const JetConstituents& constituents) {
+  for (size_t ijet = 0; ijet < jets.size(); ++ijet) {
+    build_knn_graph(jets[ijet], particles, constituents.begin(ijet), constituents.end(ijet), m_k, m_graph);
+    const uint32_t header[4] = {uint32_t(event), uint32_t(ijet), uint32_t(m_graph.n_nodes()),
+                                uint32_t(m_graph.n_neighbours)};
+    write(header, sizeof(header));
+    write(m_graph.features.data(), m_graph.features.size() * sizeof(float));
+    if (m_graph.n_nodes() <= 65536) {
+      m_short_neighbours.assign(m_graph.neighbours.begin(), m_graph.neighbours.end());
+      write(m_short_neighbours.data(), m_short_neighbours.size() * sizeof(uint16_t));
+    } else {
+      write(m_graph.neighbours.data(), m_graph.neighbours.size() * sizeof(uint32_t));
+    }
+    ++m_graphs;
+  }
+}
+
+bool JetGraphWriter::close() {
+  if (!m_file) return false;
+  if (fclose(m_file) != 0) m_ok = false;
+  m_file = nullptr;
+  if (!m_ok) cerr << "Failed to write jet graphs" << endl;
+  return m_ok;
+}
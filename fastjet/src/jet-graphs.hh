@@ -0,0 +1,90 @@
+// jet-graphs.hh
+// MIT Licenced, Copyright (c) 2024 CERN
+//
+// k-nearest-neighbour graphs of the constituents of selected jets in
+// (delta eta, delta phi), for point cloud and graph network taggers,
+// written to a compact binary file
+
+#ifndef JET_GRAPHS_HH
+#define JET_GRAPHS_HH
+
+#include <cstdint>
+#include <cstdio>
+#include <string>
+#include <vector>
+
+#include "fastjet/PseudoJet.hh"
+
+#include "constituent-index.hh"
+
+// Node features: delta eta and delta phi from the jet axis, and the
+// fractions of the jet pt and energy
+constexpr int kGraphFeatures = 4;
+
+// Each node has the same number of neighbours, so the edges are stored as
+// a neighbour list per node (nearest first); the edge index of node i is
+// (neighbours[i * n_neighbours + j], i) for j < n_neighbours
+struct JetGraph {
+  int n_neighbours = 0;
+  std::vector<float> features;
+  std::vector<uint32_t> neighbours;
+
+  size_t n_nodes() const { return features.size() / kGraphFeatures; }
+};
+
+// Build the graph of the constituents, particles[*begin] to
+// particles[*(end - 1)], of jet, with each node connected to its k nearest
+// neighbours (or all the other nodes if there are fewer). Neighbours are
+// searched on a grid of cells holding about k constituents each, visiting
+// rings of cells around the node until no unvisited cell can hold a
+// closer constituent; small jets use all pairwise distances.
+void build_knn_graph(const fastjet::PseudoJet& jet, const std::vector<fastjet::PseudoJet>& particles,
+                     const int* begin, const int* end, int k, JetGraph& graph);
+
+// The same graph from all pairwise distances, as a reference
+void build_knn_graph_all_pairs(const fastjet::PseudoJet& jet, const std::vector<fastjet::PseudoJet>& particles,
+                               const int* begin, const int* end, int k, JetGraph& graph);
+
+// True if both graphs have the same nodes and each node's neighbours are
+// at the same distances (neighbours at equal distances may differ)
+bool equivalent_knn_graphs(const JetGraph& a, const JetGraph& b);
+
+// Binary graph file, in host byte order: an 8 byte "JETGRAPH" magic and
+// uint32 version, number of node features and k; then one record per jet
+// of uint32 event, jet, number of nodes and number of neighbours, float32
+// node features and the neighbour lists, as uint16 for jets of up to 65536
+// constituents and uint32 above
+class JetGraphWriter {
+public:
+  JetGraphWriter(const std::string& filename, int k);
+  ~JetGraphWriter();
+
+  JetGraphWriter(const JetGraphWriter&) = delete;
+  JetGraphWriter& operator=(const JetGraphWriter&) = delete;
+
+  // False if the output file could not be opened
+  bool is_open() const { return m_file != nullptr; }
+
+  // Build and write the graphs of the jets of one event, whose
+  // constituents index into particles; event numbers are counted from 1,
+  // as in the text dump, and jets from 0 in the order given
+  void add_event(size_t event, const std::vector<fastjet::PseudoJet>& particles,
+                 const std::vector<fastjet::PseudoJet>& jets, const JetConstituents& constituents);
+
+  // Close the file; returns false if any write failed
+  bool close();
+
+  size_t graphs_written() const { return m_graphs; }
+
+private:
+  void write(const void* data, size_t size);
+
+  FILE* m_file = nullptr;
+  int m_k;
+  JetGraph m_graph;
+  std::vector<uint16_t> m_short_neighbours;
+  size_t m_graphs = 0;
+  bool m_ok = true;
+};
+
+#endif
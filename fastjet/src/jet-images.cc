@@ -0,0 +1,135 @@
+// jet-images.cc
+// MIT Licenced, Copyright (c) 2024 CERN
+//
+// Rasterisation of selected jets into pt images in (delta eta, delta phi)
+// for machine learning, written in batches to a NumPy .npy file
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+#include <iostream>
+
+#include "jet-images.hh"
+
+using namespace std;
+
+void rasterise_jet(const fastjet::PseudoJet& jet, const std::vector<fastjet::PseudoJet>& particles,
+                   const int* begin, const int* end, int pixels, double half_width, float* image) {
+  const auto n = size_t(end - begin);
+  thread_local std::vector<double> deta, dphi, pt;
+  thread_local std::vector<int> pixel;
+  deta.resize(n);
+  dphi.resize(n);
+  pt.resize(n);
+  pixel.resize(n);
+
+  // Gather constituent coordinates relative to the jet axis
+  const auto jet_eta = jet.eta();
+  const auto jet_phi = jet.phi();
+  for (size_t k = 0; k < n; ++k) {
+    const auto& p = particles[begin[k]];
+    pt[k] = p.pt();
+    if (pt[k] == 0.0) {
+      deta[k] = dphi[k] = 0.0;
+      continue;
+    }
+    deta[k] = p.eta() - jet_eta;
+    auto d = p.phi() - jet_phi;
+    if (d > fastjet::pi) d -= fastjet::twopi;
+    if (d < -fastjet::pi) d += fastjet::twopi;
+    dphi[k] = d;
+  }
+
+  // Principal axis from the pt weighted second moments
+  double sum_pt = 0.0, sxx = 0.0, syy = 0.0, sxy = 0.0;
+  for (size_t k = 0; k < n; ++k) {
+    sum_pt += pt[k];
+    sxx += pt[k] * deta[k] * deta[k];
+    syy += pt[k] * dphi[k] * dphi[k];
+    sxy += pt[k] * deta[k] * dphi[k];
+  }
+  const auto theta = sum_pt > 0.0 ? 0.5 * std::atan2(2.0 * sxy, sxx - syy) : 0.0;
+  const auto c = std::cos(theta);
+  const auto s = std::sin(theta);
+
+  // Rotated coordinates to pixel index, -1 outside the image
+  const auto scale = pixels / (2.0 * half_width);
+  const auto offset = 0.5 * pixels;
+  for (size_t k = 0; k < n; ++k) {
+    auto x = (c * deta[k] + s * dphi[k]) * scale + offset;
+    auto y = (c * dphi[k] - s * deta[k]) * scale + offset;
+    auto inside = x >= 0.0 && x < pixels && y >= 0.0 && y < pixels;
+    pixel[k] = inside ? int(y) * pixels + int(x) : -1;
+  }
+
+  for (size_t k = 0; k < n; ++k) {
+    if (pixel[k] >= 0) image[pixel[k]] += float(pt[k]);
+  }
+}
+
+JetImageWriter::JetImageWriter(const std::string& filename, int pixels, double half_width, size_t batch_images)
+    : m_pixels(pixels), m_half_width(half_width), m_batch_images(std::max<size_t>(batch_images, 1)) {
+  m_file = fopen(filename.c_str(), "wb");
+  if (!m_file) {
+    cerr << "Failed to open jet image file " << filename << endl;
+    return;
+  }
+  m_batch.assign(m_batch_images * m_pixels * m_pixels, 0.0f);
+  // Placeholder header, rewritten with the number of images by close()
+  m_ok = write_header();
+}
+
+JetImageWriter::~JetImageWriter() {
+  if (m_file) close();
+}
+
+bool JetImageWriter::write_header() {
+  // NumPy format 1.0: magic string, version, header length and a Python
+  // dict literal padded with spaces to a multiple of 64 bytes. The shape
+  // has a fixed width, so the header can be rewritten in place.
+  const uint16_t one = 1;
+  unsigned char little_endian;
+  std::memcpy(&little_endian, &one, 1);
+  char dict[128];
+  auto dict_len = snprintf(dict, sizeof(dict), "{'descr': '%cf4', 'fortran_order': False, 'shape': (%20zu, %d, %d), }",
+                           little_endian ? '<' : '>', m_images, m_pixels, m_pixels);
+  std::string header("\x93NUMPY\x01\x00", 8);
+  auto header_len = ((10 + dict_len + 1 + 63) / 64) * 64 - 10;
+  header.push_back(char(header_len & 0xff));
+  header.push_back(char(header_len >> 8));
+  header.append(dict, dict_len);
+  header.append(header_len - dict_len - 1, ' ');
+  header.push_back('\n');
+  return fwrite(header.data(), 1, header.size(), m_file) == header.size();
+}
+
+void JetImageWriter::add_event(const std::vector<fastjet::PseudoJet>& particles,
+                               const std::vector<fastjet::PseudoJet>& jets, const JetConstituents& constituents) {
+  const size_t image_size = m_pixels * m_pixels;
+  for (size_t ijet = 0; ijet < jets.size(); ++ijet) {
+    auto image = m_batch.data() + m_batch_used * image_size;
+    rasterise_jet(jets[ijet], particles, constituents.begin(ijet), constituents.end(ijet), m_pixels, m_half_width,
+                  image);
+    if (++m_batch_used == m_batch_images) flush_batch();
+  }
+}
+
+void JetImageWriter::flush_batch() {
+  const size_t image_size = m_pixels * m_pixels;
+  auto n_floats = m_batch_used * image_size;
+  if (fwrite(m_batch.data(), sizeof(float), n_floats, m_file) != n_floats) m_ok = false;
+  m_images += m_batch_used;
+  std::fill(m_batch.begin(), m_batch.begin() + n_floats, 0.0f);
+  m_batch_used = 0;
+}
+
+bool JetImageWriter::close() {
+  if (!m_file) return false;
+  if (m_batch_used > 0) flush_batch();
+  if (fseek(m_file, 0, SEEK_SET) != 0 || !write_header()) m_ok = false;
+  if (fclose(m_file) != 0) m_ok = false;
+  m_file = nullptr;
+  if (!m_ok) cerr << "Failed to write jet images" << endl;
+  return m_ok;
+}
@@ -0,0 +1,67 @@
+// jet-images.hh
+// MIT Licenced, Copyright (c) 2024 CERN
+//
+// Rasterisation of selected jets into pt images in (delta eta, delta phi)
+// for machine learning, written in batches to a NumPy .npy file
+
+#ifndef JET_IMAGES_HH
+#define JET_IMAGES_HH
+
+#include <cstdio>
+#include <string>
+#include <vector>
+
+#include "fastjet/PseudoJet.hh"
+
+#include "constituent-index.hh"
+
+// Fill image (pixels x pixels, row major, zeroed by the caller) with the pt
+// of the constituents, particles[*begin]..particles[*(end - 1)] of jet.
+// Constituents are placed relative to the jet axis and rotated so that the
+// pt weighted principal axis runs along the rows (delta eta); the image
+// spans +-half_width in both directions and constituents outside it are
+// dropped. Coordinates are computed in per-thread buffers, in separate
+// passes that the compiler can vectorise, before the pixel scatter.
+void rasterise_jet(const fastjet::PseudoJet& jet, const std::vector<fastjet::PseudoJet>& particles,
+                   const int* begin, const int* end, int pixels, double half_width, float* image);
+
+// Images are accumulated into a batch buffer, written out when full; the
+// file is a float32 array of shape (jets, pixels, pixels), in the order
+// of events and of the jets in each event
+class JetImageWriter {
+public:
+  JetImageWriter(const std::string& filename, int pixels, double half_width, size_t batch_images = 1024);
+  ~JetImageWriter();
+
+  JetImageWriter(const JetImageWriter&) = delete;
+  JetImageWriter& operator=(const JetImageWriter&) = delete;
+
+  // False if the output file could not be opened
+  bool is_open() const { return m_file != nullptr; }
+
+  // Add the images of the jets of one event, whose constituents index
+  // into particles
+  void add_event(const std::vector<fastjet::PseudoJet>& particles, const std::vector<fastjet::PseudoJet>& jets,
+                 const JetConstituents& constituents);
+
+  // Write the last partial batch and the final array shape, and close the
+  // file; returns false if any write failed
+  bool close();
+
+  size_t images_written() const { return m_images; }
+
+private:
+  bool write_header();
+  void flush_batch();
+
+  FILE* m_file = nullptr;
+  int m_pixels;
+  double m_half_width;
+  size_t m_batch_images;
+  std::vector<float> m_batch;
+  size_t m_batch_used = 0;
+  size_t m_images = 0;
+  bool m_ok = true;
+};
+
+#endif
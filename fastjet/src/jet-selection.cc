@@ -0,0 +1,90 @@
+// jet-selection.cc
+// MIT Licenced, Copyright (c) 2024 CERN
+//
+// Selection of the final jets of an event and projection of the
+// jet quantities that are written out
+
+#include <algorithm>
+#include <sstream>
+#include <stdexcept>
+
+#include "jet-selection.hh"
+
+unsigned int parse_jet_fields(const std::string& fields) {
+  unsigned int mask = 0;
+  std::istringstream ss(fields);
+  std::string name;
+  while (std::getline(ss, name, ',')) {
+    if (name == "rap") {
+      mask |= kJetRap;
+    } else if (name == "eta") {
+      mask |= kJetEta;
+    } else if (name == "phi") {
+      mask |= kJetPhi;
+    } else if (name == "pt") {
+      mask |= kJetPt;
+    } else if (name == "px") {
+      mask |= kJetPx;
+    } else if (name == "py") {
+      mask |= kJetPy;
+    } else if (name == "pz") {
+      mask |= kJetPz;
+    } else if (name == "E") {
+      mask |= kJetE;
+    } else if (name == "m") {
+      mask |= kJetMass;
+    } else if (name == "nconst") {
+      mask |= kJetNConstituents;
+    } else if (name == "constituents") {
+      mask |= kJetConstituents;
+    } else if (name == "p4") {
+      mask |= kJetPx | kJetPy | kJetPz | kJetE;
+    } else {
+      throw std::invalid_argument("Unknown jet output field: " + name);
+    }
+  }
+  if (mask == 0) {
+    throw std::invalid_argument("No jet output fields requested");
+  }
+  return mask;
+}
+
+void select_leading_jets(std::vector<fastjet::PseudoJet>& jets, int topk) {
+  // kt2 is cached in the PseudoJet, so ordering on it avoids any sqrt
+  auto harder = [](const fastjet::PseudoJet& a, const fastjet::PseudoJet& b) {
+    return a.kt2() > b.kt2();
+  };
+  if (topk > 0 && size_t(topk) < jets.size()) {
+    std::partial_sort(jets.begin(), jets.begin() + topk, jets.end(), harder);
+    jets.resize(topk);
+  } else {
+    std::stable_sort(jets.begin(), jets.end(), harder);
+  }
+}
+
+void dump_jets(FILE* fh, const std::vector<fastjet::PseudoJet>& jets, unsigned int fields,
+               const JetConstituents* constituents) {
+  if ((fields & kJetConstituentFields) && !constituents) {
+    throw std::invalid_argument("Constituent fields need the constituent index of the jets");
+  }
+  for (unsigned int i = 0; i < jets.size(); i++) {
+    const auto& jet = jets[i];
+    fprintf(fh, "%5u", i);
+    // N.B. the order of output columns is fixed, independent of the order
+    // in which fields were requested
+    if (fields & kJetRap) fprintf(fh, " %15.10f", jet.rap());
+    if (fields & kJetEta) fprintf(fh, " %15.10f", jet.eta());
+    if (fields & kJetPhi) fprintf(fh, " %15.10f", jet.phi());
+    if (fields & kJetPt) fprintf(fh, " %15.10f", jet.perp());
+    if (fields & kJetPx) fprintf(fh, " %15.10f", jet.px());
+    if (fields & kJetPy) fprintf(fh, " %15.10f", jet.py());
+    if (fields & kJetPz) fprintf(fh, " %15.10f", jet.pz());
+    if (fields & kJetE) fprintf(fh, " %15.10f", jet.E());
+    if (fields & kJetMass) fprintf(fh, " %15.10f", jet.m());
+    if (fields & kJetNConstituents) fprintf(fh, " %5zu", constituents->size(i));
+    if (fields & kJetConstituents) {
+      for (auto c = constituents->begin(i); c != constituents->end(i); ++c) fprintf(fh, " %d", *c);
+    }
+    fprintf(fh, "\n");
+  }
+}
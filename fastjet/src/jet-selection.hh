@@ -0,0 +1,56 @@
+// jet-selection.hh
+// MIT Licenced, Copyright (c) 2024 CERN
+//
+// Selection of the final jets of an event and projection of the
+// jet quantities that are written out
+
+#ifndef JET_SELECTION_HH
+#define JET_SELECTION_HH
+
+#include <cstdio>
+#include <string>
+#include <vector>
+
+#include "fastjet/PseudoJet.hh"
+
+#include "constituent-index.hh"
+
+// Jet quantities that can be requested for output, as bit flags
+enum JetField : unsigned int {
+  kJetRap = 1u << 0,
+  kJetEta = 1u << 1,
+  kJetPhi = 1u << 2,
+  kJetPt = 1u << 3,
+  kJetPx = 1u << 4,
+  kJetPy = 1u << 5,
+  kJetPz = 1u << 6,
+  kJetE = 1u << 7,
+  kJetMass = 1u << 8,
+  kJetNConstituents = 1u << 9,
+  kJetConstituents = 1u << 10,
+};
+
+// Fields that need the flat constituent index of the event
+constexpr unsigned int kJetConstituentFields = kJetNConstituents | kJetConstituents;
+
+// The classic fastjet-finder output of rap, phi and pt
+constexpr unsigned int kDefaultJetFields = kJetRap | kJetPhi | kJetPt;
+
+// Parse a comma separated list of field names (rap, eta, phi, pt, px, py,
+// pz, E, m, nconst, constituents); "p4" is shorthand for px,py,pz,E. Throws
+// std::invalid_argument for unknown names.
+unsigned int parse_jet_fields(const std::string& fields);
+
+// Order the jets by decreasing pt; if topk > 0 only the leading topk jets
+// are kept, using a partial sort so the rest are never ordered
+void select_leading_jets(std::vector<fastjet::PseudoJet>& jets, int topk = -1);
+
+// Write the requested fields for each jet, preceded by the jet index;
+// only the quantities asked for are computed. Constituent fields are taken
+// from the constituent index of the jets, which must then be given; the
+// constituent particle indexes are written last, as a space separated list.
+void dump_jets(FILE* fh, const std::vector<fastjet::PseudoJet>& jets,
+               unsigned int fields = kDefaultJetFields,
+               const JetConstituents* constituents = nullptr);
+
+#endif
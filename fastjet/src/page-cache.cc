@@ -0,0 +1,64 @@
+// page-cache.cc
+// MIT Licenced, Copyright (c) 2024 CERN
+//
+// Control of the page cache for input files, to benchmark loading from
+// storage (cold) as well as from memory (warm)
+
+#include <cstring>
+#include <iostream>
+#include <vector>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "page-cache.hh"
+
+using namespace std;
+
+size_t file_size(const std::string& filename) {
+  struct stat st;
+  if (stat(filename.c_str(), &st) != 0) return 0;
+  return st.st_size;
+}
+
+double page_cache_residency(const std::string& filename) {
+  auto size = file_size(filename);
+  if (size == 0) return -1.0;
+  auto fd = open(filename.c_str(), O_RDONLY);
+  if (fd < 0) return -1.0;
+  // Mapping the file does not fault any pages in
+  auto addr = mmap(nullptr, size, PROT_READ, MAP_SHARED, fd, 0);
+  close(fd);
+  if (addr == MAP_FAILED) return -1.0;
+
+  const auto page_size = size_t(sysconf(_SC_PAGESIZE));
+  const auto n_pages = (size + page_size - 1) / page_size;
+  std::vector<unsigned char> resident(n_pages);
+  double fraction = -1.0;
+  if (mincore(addr, size, resident.data()) == 0) {
+    size_t n_resident = 0;
+    for (auto r : resident) n_resident += r & 1;
+    fraction = double(n_resident) / n_pages;
+  }
+  munmap(addr, size);
+  return fraction;
+}
+
+bool evict_from_page_cache(const std::string& filename) {
+  auto fd = open(filename.c_str(), O_RDONLY);
+  if (fd < 0) {
+    cerr << "Failed to open " << filename << ": " << strerror(errno) << endl;
+    return false;
+  }
+  // Dirty pages (e.g., of a freshly generated file) can not be dropped
+  fdatasync(fd);
+  auto ret = posix_fadvise(fd, 0, 0, POSIX_FADV_DONTNEED);
+  close(fd);
+  if (ret != 0) {
+    cerr << "posix_fadvise failed for " << filename << ": " << strerror(ret) << endl;
+    return false;
+  }
+  return true;
+}
@@ -0,0 +1,26 @@
+// page-cache.hh
+// MIT Licenced, Copyright (c) 2024 CERN
+//
+// Control of the page cache for input files, to benchmark loading from
+// storage (cold) as well as from memory (warm)
+
+#ifndef PAGE_CACHE_HH
+#define PAGE_CACHE_HH
+
+#include <string>
+
+// Size of a file in bytes, or 0 if it can not be read
+size_t file_size(const std::string& filename);
+
+// Fraction of the file's pages currently in the page cache (from mincore),
+// or a negative value if this can not be determined
+double page_cache_residency(const std::string& filename);
+
+// Ask the kernel to drop the file's pages from the page cache (after
+// flushing any dirty pages, with posix_fadvise POSIX_FADV_DONTNEED). This
+// is only advice, and pages mapped by other processes are kept, so check
+// page_cache_residency afterwards; returns false if the advice could not
+// be given.
+bool evict_from_page_cache(const std::string& filename);
+
+#endif
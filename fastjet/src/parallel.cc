@@ -0,0 +1,188 @@
+// parallel.cc
+// MIT Licenced, Copyright (c) 2024 CERN
+//
+// Parallel loop over events with interchangeable runtime backends: a
+// hand-written std::thread pool, OpenMP and oneTBB
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <mutex>
+#include <stdexcept>
+#include <thread>
+
+#ifdef _OPENMP
+#include <omp.h>
+#endif
+
+#ifdef FASTJET_FINDER_HAVE_TBB
+#include <tbb/blocked_range.h>
+#include <tbb/parallel_for.h>
+#include <tbb/partitioner.h>
+#include <tbb/task_arena.h>
+#endif
+
+#include "parallel.hh"
+
+const char* backend_name(ParallelBackend backend) {
+  switch (backend) {
+    case ParallelBackend::ThreadPool:
+      return "pool";
+    case ParallelBackend::OpenMP:
+      return "openmp";
+    case ParallelBackend::TBB:
+      return "tbb";
+  }
+  return "unknown";
+}
+
+ParallelBackend parse_parallel_backend(const std::string& name) {
+  for (auto backend : {ParallelBackend::ThreadPool, ParallelBackend::OpenMP, ParallelBackend::TBB}) {
+    if (name == backend_name(backend)) return backend;
+  }
+  throw std::invalid_argument("Unknown parallel backend: " + name + " (valid values are pool, openmp, tbb)");
+}
+
+bool backend_available(ParallelBackend backend) {
+  switch (backend) {
+    case ParallelBackend::ThreadPool:
+      return true;
+    case ParallelBackend::OpenMP:
+#ifdef _OPENMP
+      return true;
+#else
+      return false;
+#endif
+    case ParallelBackend::TBB:
+#ifdef FASTJET_FINDER_HAVE_TBB
+      return true;
+#else
+      return false;
+#endif
+  }
+  return false;
+}
+
+std::vector<ParallelBackend> available_backends() {
+  std::vector<ParallelBackend> backends;
+  for (auto backend : {ParallelBackend::ThreadPool, ParallelBackend::OpenMP, ParallelBackend::TBB}) {
+    if (backend_available(backend)) backends.push_back(backend);
+  }
+  return backends;
+}
+
+// Persistent state of a backend: the pool's worker threads (the calling
+// thread takes part in each loop as thread 0), or the TBB arena
+struct ParallelLoop::Pool {
+  std::vector<std::thread> workers;
+  std::mutex mutex;
+  std::condition_variable start_cv;
+  std::condition_variable done_cv;
+  const ParallelBody* body = nullptr;
+  size_t n_items = 0;
+  std::atomic<size_t> next_item{0};
+  unsigned generation = 0;
+  int running = 0;
+  bool stop = false;
+#ifdef FASTJET_FINDER_HAVE_TBB
+  std::unique_ptr<tbb::task_arena> arena;
+#endif
+
+  void work(int thread) {
+    for (auto item = next_item++; item < n_items; item = next_item++) (*body)(item, thread);
+  }
+
+  void worker(int thread) {
+    unsigned seen = 0;
+    std::unique_lock<std::mutex> lock(mutex);
+    while (true) {
+      start_cv.wait(lock, [&] { return stop || generation != seen; });
+      if (stop) return;
+      seen = generation;
+      lock.unlock();
+      work(thread);
+      lock.lock();
+      if (--running == 0) done_cv.notify_one();
+    }
+  }
+
+  void run(size_t n, const ParallelBody& loop_body) {
+    {
+      std::lock_guard<std::mutex> lock(mutex);
+      body = &loop_body;
+      n_items = n;
+      next_item = 0;
+      running = workers.size();
+      ++generation;
+    }
+    start_cv.notify_all();
+    work(0);
+    std::unique_lock<std::mutex> lock(mutex);
+    done_cv.wait(lock, [&] { return running == 0; });
+  }
+};
+
+ParallelLoop::ParallelLoop(ParallelBackend backend, int n_threads)
+    : m_backend(backend), m_n_threads(std::max(n_threads, 1)), m_pool(new Pool) {
+  if (!backend_available(backend)) {
+    throw std::invalid_argument(std::string("Parallel backend ") + backend_name(backend) +
+                                " is not available in this build");
+  }
+  if (backend == ParallelBackend::ThreadPool) {
+    for (int thread = 1; thread < m_n_threads; ++thread) {
+      m_pool->workers.emplace_back(&Pool::worker, m_pool.get(), thread);
+    }
+  }
+#ifdef FASTJET_FINDER_HAVE_TBB
+  if (backend == ParallelBackend::TBB) {
+    m_pool->arena.reset(new tbb::task_arena(m_n_threads));
+    m_pool->arena->initialize();
+  }
+#endif
+}
+
+ParallelLoop::~ParallelLoop() {
+  {
+    std::lock_guard<std::mutex> lock(m_pool->mutex);
+    m_pool->stop = true;
+  }
+  m_pool->start_cv.notify_all();
+  for (auto& worker : m_pool->workers) worker.join();
+}
+
+void ParallelLoop::run(size_t n_items, const ParallelBody& body) {
+  switch (m_backend) {
+    case ParallelBackend::ThreadPool:
+      m_pool->run(n_items, body);
+      break;
+    case ParallelBackend::OpenMP:
+#ifdef _OPENMP
+#pragma omp parallel for schedule(dynamic, 1) num_threads(m_n_threads)
+      for (long item = 0; item < long(n_items); ++item) body(item, omp_get_thread_num());
+#endif
+      break;
+    case ParallelBackend::TBB:
+#ifdef FASTJET_FINDER_HAVE_TBB
+      m_pool->arena->execute([&] {
+        tbb::parallel_for(
+            tbb::blocked_range<size_t>(0, n_items, 1),
+            [&](const tbb::blocked_range<size_t>& range) {
+              int thread = tbb::this_task_arena::current_thread_index();
+              for (auto item = range.begin(); item != range.end(); ++item) body(item, thread);
+            },
+            tbb::simple_partitioner());
+      });
+#endif
+      break;
+  }
+}
+
+double ParallelLoop::overhead_per_item(size_t n_items) {
+  std::vector<size_t> counts(m_n_threads * 16, 0);
+  auto start_t = std::chrono::steady_clock::now();
+  // Per-thread counters, spaced to avoid false sharing
+  run(n_items, [&](size_t, int thread) { ++counts[thread * 16]; });
+  auto stop_t = std::chrono::steady_clock::now();
+  return std::chrono::duration<double, std::micro>(stop_t - start_t).count() / n_items;
+}
@@ -0,0 +1,59 @@
+// parallel.hh
+// MIT Licenced, Copyright (c) 2024 CERN
+//
+// Parallel loop over events with interchangeable runtime backends: a
+// hand-written std::thread pool, OpenMP and oneTBB
+
+#ifndef PARALLEL_HH
+#define PARALLEL_HH
+
+#include <functional>
+#include <memory>
+#include <string>
+#include <vector>
+
+enum class ParallelBackend { ThreadPool, OpenMP, TBB };
+
+const char* backend_name(ParallelBackend backend);
+
+// Parse "pool", "openmp" or "tbb"; throws std::invalid_argument otherwise
+ParallelBackend parse_parallel_backend(const std::string& name);
+
+// True if the backend was enabled at build time
+bool backend_available(ParallelBackend backend);
+
+std::vector<ParallelBackend> available_backends();
+
+// Body of a parallel loop: called once per item, with the index (from 0)
+// of the thread running it, which can be used to pick per-thread buffers
+using ParallelBody = std::function<void(size_t item, int thread)>;
+
+// Runs loops over items with one backend and a fixed number of threads.
+// Items are handed out dynamically (one at a time), as event processing
+// times vary widely. Workers of the thread pool (and the TBB arena) are
+// created once and reused by every loop.
+class ParallelLoop {
+public:
+  ParallelLoop(ParallelBackend backend, int n_threads);
+  ~ParallelLoop();
+
+  ParallelLoop(const ParallelLoop&) = delete;
+  ParallelLoop& operator=(const ParallelLoop&) = delete;
+
+  ParallelBackend backend() const { return m_backend; }
+  int n_threads() const { return m_n_threads; }
+
+  void run(size_t n_items, const ParallelBody& body);
+
+  // Time per item (in us) of a loop with an empty body, i.e., the
+  // scheduling overhead of the backend
+  double overhead_per_item(size_t n_items = 100000);
+
+private:
+  ParallelBackend m_backend;
+  int m_n_threads;
+  struct Pool;
+  std::unique_ptr<Pool> m_pool;
+};
+
+#endif
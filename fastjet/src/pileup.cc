@@ -0,0 +1,229 @@
+// pileup.cc
+// MIT Licenced, Copyright (c) 2024 CERN
+//
+// Pileup mitigation applied to the input particles before clustering:
+// SoftKiller, charged hadron subtraction and PUPPI-like weighting
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+
+#include "HepMC3/Attribute.h"
+#include "HepMC3/GenParticle.h"
+
+#include "pileup.hh"
+
+namespace {
+
+// Particles binned on a (rap, phi) grid with cells at least cell_size
+// wide, so that all neighbours within cell_size of a particle are in the
+// 3x3 block of cells around it. Rapidities beyond rapmax are clamped to the
+// edge cells, which preserves this property.
+class ParticleGrid {
+public:
+  ParticleGrid(const std::vector<fastjet::PseudoJet>& particles, double cell_size, double rapmax)
+      : m_rapmin(-rapmax) {
+    m_nrap = std::max(1, int(2.0 * rapmax / cell_size));
+    m_nphi = std::max(1, int(fastjet::twopi / cell_size));
+    m_rap_width = 2.0 * rapmax / m_nrap;
+    m_phi_width = fastjet::twopi / m_nphi;
+    m_cells.resize(m_nrap * m_nphi);
+    m_cell_of.reserve(particles.size());
+    for (size_t i = 0; i < particles.size(); ++i) {
+      auto cell = cell_index(particles[i].rap(), particles[i].phi());
+      m_cell_of.push_back(cell);
+      m_cells[cell].push_back(i);
+    }
+  }
+
+  int cell_index(double rap, double phi) const {
+    auto irap = std::clamp(int((rap - m_rapmin) / m_rap_width), 0, m_nrap - 1);
+    auto iphi = std::min(int(phi / m_phi_width), m_nphi - 1);
+    return irap * m_nphi + iphi;
+  }
+
+  // Distinct cells in the 3x3 block around the cell of particle i
+  void neighbour_cells(size_t i, std::vector<int>& cells) const {
+    cells.clear();
+    auto irap = m_cell_of[i] / m_nphi;
+    auto iphi = m_cell_of[i] % m_nphi;
+    for (int drap = -1; drap <= 1; ++drap) {
+      auto jrap = irap + drap;
+      if (jrap < 0 || jrap >= m_nrap) continue;
+      for (int dphi = -1; dphi <= 1; ++dphi) {
+        auto jphi = (iphi + dphi + m_nphi) % m_nphi;
+        auto cell = jrap * m_nphi + jphi;
+        if (std::find(cells.begin(), cells.end(), cell) == cells.end()) cells.push_back(cell);
+      }
+    }
+  }
+
+  const std::vector<size_t>& cell(int c) const { return m_cells[c]; }
+  size_t n_cells() const { return m_cells.size(); }
+
+private:
+  double m_rapmin, m_rap_width, m_phi_width;
+  int m_nrap, m_nphi;
+  std::vector<std::vector<size_t>> m_cells;
+  std::vector<int> m_cell_of;
+};
+
+double median(std::vector<double> values) {
+  if (values.empty()) return 0.0;
+  auto mid = values.begin() + values.size() / 2;
+  std::nth_element(values.begin(), mid, values.end());
+  if (values.size() % 2 == 1) return *mid;
+  return 0.5 * (*mid + *std::max_element(values.begin(), mid));
+}
+
+}  // namespace
+
+std::vector<ParticleInfo> final_state_info(const HepMC3::GenEvent& evt) {
+  std::vector<ParticleInfo> info;
+  info.reserve(evt.particles().size());
+  for (auto p : evt.particles()) {
+    if (p->status() == 1) {
+      ParticleInfo pi;
+      pi.charged = is_charged(p->pid());
+      auto pileup = p->attribute<HepMC3::IntAttribute>("pileup");
+      pi.pileup = pileup && pileup->value() != 0;
+      info.push_back(pi);
+    }
+  }
+  return info;
+}
+
+bool has_pileup_provenance(const std::vector<ParticleInfo>& info) {
+  return std::any_of(info.begin(), info.end(), [](const ParticleInfo& pi) { return pi.pileup; });
+}
+
+bool is_charged(int pdg_id) {
+  switch (std::abs(pdg_id)) {
+    case 11:    // e
+    case 13:    // mu
+    case 211:   // pi+
+    case 321:   // K+
+    case 2212:  // p
+    case 3112:  // Sigma-
+    case 3222:  // Sigma+
+    case 3312:  // Xi-
+    case 3334:  // Omega-
+      return true;
+    default:
+      return false;
+  }
+}
+
+double softkiller(std::vector<fastjet::PseudoJet>& particles, double grid_size, double rapmax) {
+  auto nrap = std::max(1, int(std::ceil(2.0 * rapmax / grid_size)));
+  auto nphi = std::max(1, int(std::ceil(fastjet::twopi / grid_size)));
+  std::vector<double> max_pt2(nrap * nphi, 0.0);
+  for (const auto& p : particles) {
+    auto rap = p.rap();
+    if (std::fabs(rap) >= rapmax) continue;
+    auto irap = std::min(int((rap + rapmax) / grid_size), nrap - 1);
+    auto iphi = std::min(int(p.phi() / grid_size), nphi - 1);
+    auto& cell_max = max_pt2[irap * nphi + iphi];
+    cell_max = std::max(cell_max, p.kt2());
+  }
+  auto pt2_cut = median(max_pt2);
+  particles.erase(std::remove_if(particles.begin(), particles.end(),
+                                 [pt2_cut](const fastjet::PseudoJet& p) { return p.kt2() < pt2_cut; }),
+                  particles.end());
+  return std::sqrt(pt2_cut);
+}
+
+void charged_hadron_subtraction(std::vector<fastjet::PseudoJet>& particles,
+                                const std::vector<ParticleInfo>& info) {
+  particles.erase(std::remove_if(particles.begin(), particles.end(),
+                                 [&info](const fastjet::PseudoJet& p) {
+                                   const auto& pi = info[p.user_index()];
+                                   return pi.charged && pi.pileup;
+                                 }),
+                  particles.end());
+}
+
+void puppi_weights(std::vector<fastjet::PseudoJet>& particles,
+                   const std::vector<ParticleInfo>* info, double R0, double wcut) {
+  const bool provenance = info && has_pileup_provenance(*info);
+  const auto n = particles.size();
+  const auto R02 = R0 * R0;
+  constexpr double min_dr2 = 1.0e-8;
+
+  // Local shape variable of each particle
+  std::vector<double> rap(n), phi(n), alpha(n);
+  for (size_t i = 0; i < n; ++i) {
+    rap[i] = particles[i].rap();
+    phi[i] = particles[i].phi();
+  }
+  ParticleGrid grid(particles, R0, 5.0);
+  std::vector<int> cells;
+  for (size_t i = 0; i < n; ++i) {
+    double sum = 0.0;
+    grid.neighbour_cells(i, cells);
+    for (auto c : cells) {
+      for (auto j : grid.cell(c)) {
+        if (j == i) continue;
+        if (provenance) {
+          const auto& pj = (*info)[particles[j].user_index()];
+          if (pj.charged && pj.pileup) continue;
+        }
+        auto dphi = std::fabs(phi[i] - phi[j]);
+        if (dphi > fastjet::pi) dphi = fastjet::twopi - dphi;
+        auto drap = rap[i] - rap[j];
+        auto dr2 = drap * drap + dphi * dphi;
+        if (dr2 < R02 && dr2 > min_dr2) sum += particles[j].kt2() / dr2;
+      }
+    }
+    alpha[i] = sum > 0.0 ? std::log(sum) : -std::numeric_limits<double>::infinity();
+  }
+
+  // Pileup reference distribution
+  std::vector<double> reference;
+  for (size_t i = 0; i < n; ++i) {
+    if (!std::isfinite(alpha[i])) continue;
+    if (provenance) {
+      const auto& pi = (*info)[particles[i].user_index()];
+      if (!(pi.charged && pi.pileup)) continue;
+    }
+    reference.push_back(alpha[i]);
+  }
+  // Charged pileup may already have been removed (e.g., by CHS)
+  if (reference.empty()) {
+    for (auto a : alpha) {
+      if (std::isfinite(a)) reference.push_back(a);
+    }
+  }
+  auto alpha_median = median(reference);
+  double sum2 = 0.0;
+  size_t n_left = 0;
+  for (auto a : reference) {
+    if (a <= alpha_median) {
+      sum2 += (a - alpha_median) * (a - alpha_median);
+      ++n_left;
+    }
+  }
+  auto alpha_rms = n_left > 0 ? std::sqrt(sum2 / n_left) : 1.0;
+  if (alpha_rms <= 0.0) alpha_rms = 1.0;
+
+  // Weight and rescale, dropping particles with small weights
+  std::vector<fastjet::PseudoJet> weighted;
+  weighted.reserve(n);
+  for (size_t i = 0; i < n; ++i) {
+    double w;
+    const ParticleInfo* pi = provenance ? &(*info)[particles[i].user_index()] : nullptr;
+    if (pi && pi->charged) {
+      w = pi->pileup ? 0.0 : 1.0;
+    } else if (alpha[i] <= alpha_median) {
+      w = 0.0;
+    } else {
+      // chi2 CDF for one degree of freedom
+      auto chi2 = (alpha[i] - alpha_median) * (alpha[i] - alpha_median) / (alpha_rms * alpha_rms);
+      w = std::erf(std::sqrt(0.5 * chi2));
+    }
+    if (w < wcut) continue;
+    weighted.push_back(particles[i]);
+    if (w < 1.0) weighted.back() *= w;
+  }
+  particles.swap(weighted);
+}
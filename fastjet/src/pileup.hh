@@ -0,0 +1,54 @@
+// pileup.hh
+// MIT Licenced, Copyright (c) 2024 CERN
+//
+// Pileup mitigation applied to the input particles before clustering:
+// SoftKiller, charged hadron subtraction and PUPPI-like weighting
+
+#ifndef PILEUP_HH
+#define PILEUP_HH
+
+#include <vector>
+
+#include "fastjet/PseudoJet.hh"
+
+#include "HepMC3/GenEvent.h"
+
+// Per-particle information needed for pileup mitigation
+struct ParticleInfo {
+  bool charged = false;
+  bool pileup = false;
+};
+
+// Information for the final state particles of an event, in the same order
+// as final_state_particles(); a particle is taken to come from pileup if
+// it has a non-zero "pileup" integer attribute
+std::vector<ParticleInfo> final_state_info(const HepMC3::GenEvent& evt);
+
+// True if any particle of the event has pileup provenance
+bool has_pileup_provenance(const std::vector<ParticleInfo>& info);
+
+// Charge of the long lived particles expected in the final state
+bool is_charged(int pdg_id);
+
+// SoftKiller: the pt threshold is the median over (rap, phi) cells of size
+// grid_size (within |rap| < rapmax) of the maximum particle pt in each
+// cell; all particles below the threshold are removed. Returns the
+// threshold.
+double softkiller(std::vector<fastjet::PseudoJet>& particles, double grid_size, double rapmax);
+
+// Remove charged particles from pileup; particles are looked up in info by
+// their user index
+void charged_hadron_subtraction(std::vector<fastjet::PseudoJet>& particles,
+                                const std::vector<ParticleInfo>& info);
+
+// PUPPI-like weighting: alpha_i = log(sum_j (pt_j / dR_ij)^2) over
+// neighbours within R0 is compared to the median and (left side) RMS of the
+// pileup alpha distribution, taken from charged pileup particles when info
+// has provenance (and any remain) and from all particles otherwise.
+// Particles are rescaled by their weight, and dropped if the weight is below
+// wcut. With provenance, charged particles get weight 1 (leading vertex) or
+// 0 (pileup). info may be null.
+void puppi_weights(std::vector<fastjet::PseudoJet>& particles,
+                   const std::vector<ParticleInfo>* info, double R0, double wcut);
+
+#endif
@@ -0,0 +1,178 @@
+// premerge.cc
+// MIT Licenced, Copyright (c) 2024 CERN
+//
+// Merging of nearly collinear input particles before clustering, and a
+// report of its impact on the clustering time and on the jets
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdint>
+#include <iostream>
+#include <numeric>
+
+#include "premerge.hh"
+
+using namespace std;
+
+namespace {
+
+inline double delta_r2(double rap1, double phi1, double rap2, double phi2) {
+  auto dphi = std::fabs(phi1 - phi2);
+  if (dphi > fastjet::pi) dphi = fastjet::twopi - dphi;
+  auto drap = rap1 - rap2;
+  return drap * drap + dphi * dphi;
+}
+
+}  // namespace
+
+void collinear_premerge(std::vector<fastjet::PseudoJet>& particles, double dR) {
+  const auto n = particles.size();
+  if (n < 2 || dR <= 0.0) return;
+
+  // Cells are dR wide in rap and 2pi / nphi >= dR wide in phi
+  const auto nphi = std::max(1, int(fastjet::twopi / dR));
+  const auto phi_width = fastjet::twopi / nphi;
+  thread_local std::vector<double> rap, phi;
+  thread_local std::vector<std::pair<int64_t, size_t>> cells;
+  rap.resize(n);
+  phi.resize(n);
+  cells.resize(n);
+  auto cell_key = [nphi](int64_t irap, int64_t iphi) { return irap * nphi + (iphi + nphi) % nphi; };
+  for (size_t i = 0; i < n; ++i) {
+    rap[i] = particles[i].rap();
+    phi[i] = particles[i].phi();
+    auto iphi = std::min(int(phi[i] / phi_width), nphi - 1);
+    cells[i] = {cell_key(int64_t(std::floor(rap[i] / dR)), iphi), i};
+  }
+  std::sort(cells.begin(), cells.end());
+
+  thread_local std::vector<size_t> order;
+  order.resize(n);
+  std::iota(order.begin(), order.end(), 0);
+  std::sort(order.begin(), order.end(), [&](size_t a, size_t b) {
+    return particles[a].kt2() > particles[b].kt2();
+  });
+
+  // Particles along the beam (zero pt) have no meaningful (rap, phi), so
+  // they are passed through as they are
+  thread_local std::vector<char> merged;
+  merged.resize(n);
+  std::vector<fastjet::PseudoJet> output;
+  output.reserve(n);
+  for (size_t i = 0; i < n; ++i) {
+    merged[i] = particles[i].kt2() == 0.0;
+    if (merged[i]) {
+      output.push_back(particles[i]);
+      output.back().set_user_index(output.size() - 1);
+    }
+  }
+
+  const auto dR2 = dR * dR;
+  const int phi_steps = std::min(nphi, 3);
+  for (auto i : order) {
+    if (merged[i]) continue;
+    merged[i] = 1;
+    auto sum = particles[i];
+    auto irap = int64_t(std::floor(rap[i] / dR));
+    auto iphi = std::min(int(phi[i] / phi_width), nphi - 1);
+    for (int64_t drap = -1; drap <= 1; ++drap) {
+      // With fewer than 3 phi cells, each is visited once
+      for (int dphi = -1; dphi < phi_steps - 1; ++dphi) {
+        auto key = cell_key(irap + drap, iphi + dphi);
+        auto it = std::lower_bound(cells.begin(), cells.end(), std::make_pair(key, size_t(0)));
+        for (; it != cells.end() && it->first == key; ++it) {
+          auto j = it->second;
+          if (merged[j] || delta_r2(rap[i], phi[i], rap[j], phi[j]) >= dR2) continue;
+          merged[j] = 1;
+          sum += particles[j];
+        }
+      }
+    }
+    output.push_back(sum);
+    output.back().set_user_index(output.size() - 1);
+  }
+  particles.swap(output);
+}
+
+void run_premerge_impact(double dR, int trials, size_t first_event, size_t n_events,
+                         const std::function<const std::vector<fastjet::PseudoJet>&(size_t)>& get_event,
+                         const fastjet::JetDefinition& jet_def,
+                         const std::function<std::vector<fastjet::PseudoJet>(const fastjet::ClusterSequence&)>& select_jets) {
+  using clock = std::chrono::steady_clock;
+  const auto R = jet_def.R();
+
+  double time_unmerged = 0.0, time_premerge = 0.0, time_merged = 0.0;
+  size_t n_particles = 0, n_merged_particles = 0;
+  size_t n_unmerged_jets = 0, n_merged_jets = 0, n_matched = 0;
+  double sum_dpt = 0.0, max_dpt = 0.0, sum_dr = 0.0, max_dr = 0.0;
+
+  std::vector<fastjet::PseudoJet> merged_particles;
+  for (int trial = 0; trial < trials; ++trial) {
+    for (size_t ievt = first_event; ievt < n_events; ++ievt) {
+      const auto& particles = get_event(ievt);
+
+      auto start_t = clock::now();
+      fastjet::ClusterSequence unmerged_cs(particles, jet_def);
+      auto unmerged_jets = select_jets(unmerged_cs);
+      auto unmerged_t = clock::now();
+      merged_particles = particles;
+      collinear_premerge(merged_particles, dR);
+      auto premerge_t = clock::now();
+      fastjet::ClusterSequence merged_cs(merged_particles, jet_def);
+      auto merged_jets = select_jets(merged_cs);
+      auto merged_t = clock::now();
+
+      time_unmerged += std::chrono::duration<double, std::micro>(unmerged_t - start_t).count();
+      time_premerge += std::chrono::duration<double, std::micro>(premerge_t - unmerged_t).count();
+      time_merged += std::chrono::duration<double, std::micro>(merged_t - premerge_t).count();
+
+      if (trial > 0) continue;
+      n_particles += particles.size();
+      n_merged_particles += merged_particles.size();
+      n_unmerged_jets += unmerged_jets.size();
+      n_merged_jets += merged_jets.size();
+
+      // Match each unmerged jet to the closest merged jet
+      for (const auto& unmerged_jet : unmerged_jets) {
+        double best_dr2 = 1.0e20;
+        const fastjet::PseudoJet* best = nullptr;
+        for (const auto& merged_jet : merged_jets) {
+          auto dr2 = unmerged_jet.squared_distance(merged_jet);
+          if (dr2 < best_dr2) {
+            best_dr2 = dr2;
+            best = &merged_jet;
+          }
+        }
+        if (best && best_dr2 < 0.01 * R * R) {
+          ++n_matched;
+          auto dpt = std::fabs(best->pt() - unmerged_jet.pt()) / unmerged_jet.pt();
+          auto dr = std::sqrt(best_dr2);
+          sum_dpt += dpt;
+          max_dpt = std::max(max_dpt, dpt);
+          sum_dr += dr;
+          max_dr = std::max(max_dr, dr);
+        }
+      }
+    }
+  }
+
+  const auto n_counted = double(std::max(n_events, first_event + 1) - first_event);
+  const auto n_timed = n_counted * trials;
+  cout << "Collinear pre-merging: dR " << dR << endl;
+  cout << "Mean particles per event " << n_particles / n_counted << ", after pre-merging "
+       << n_merged_particles / n_counted << " (reduction factor "
+       << double(n_particles) / std::max<size_t>(n_merged_particles, 1) << ")" << endl;
+  cout << "Unmerged clustering time per event " << time_unmerged / n_timed << " us" << endl;
+  cout << "Pre-merging time per event " << time_premerge / n_timed << " us" << endl;
+  cout << "Merged clustering time per event " << time_merged / n_timed << " us" << endl;
+  auto saved = time_unmerged - time_premerge - time_merged;
+  cout << "Time saved per event " << saved / n_timed << " us (" << 100.0 * saved / time_unmerged
+       << "% of unmerged clustering)" << endl;
+  cout << "Jets: unmerged " << n_unmerged_jets << ", merged " << n_merged_jets << ", matched "
+       << n_matched << " (dR < 0.1 R)" << endl;
+  if (n_matched > 0) {
+    cout << "Matched jet relative pt difference: mean " << sum_dpt / n_matched << ", max " << max_dpt << endl;
+    cout << "Matched jet axis difference dR: mean " << sum_dr / n_matched << ", max " << max_dr << endl;
+  }
+}
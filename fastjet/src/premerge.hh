@@ -0,0 +1,33 @@
+// premerge.hh
+// MIT Licenced, Copyright (c) 2024 CERN
+//
+// Merging of nearly collinear input particles before clustering, and a
+// report of its impact on the clustering time and on the jets
+
+#ifndef PREMERGE_HH
+#define PREMERGE_HH
+
+#include <functional>
+#include <vector>
+
+#include "fastjet/ClusterSequence.hh"
+#include "fastjet/PseudoJet.hh"
+
+// Merge particles closer than dR in (rap, phi): taking particles in order
+// of decreasing pt, each particle not yet merged absorbs (E-scheme) all the
+// unmerged particles within dR of it. Neighbours are found by sorting the
+// particles into (rap, phi) cells at least dR wide, so the cost does not
+// grow with the number of particle pairs. Particles with zero pt are left
+// unmerged. The output particles have the user index set to their position.
+void collinear_premerge(std::vector<fastjet::PseudoJet>& particles, double dR);
+
+// For events first_event..n_events-1, cluster the particles as they are
+// and after pre-merging with dR, and report the multiplicity reduction,
+// the time of pre-merging and of both clusterings, and the deviations of
+// the merged jets (from select_jets) from the matching unmerged jets
+void run_premerge_impact(double dR, int trials, size_t first_event, size_t n_events,
+                         const std::function<const std::vector<fastjet::PseudoJet>&(size_t)>& get_event,
+                         const fastjet::JetDefinition& jet_def,
+                         const std::function<std::vector<fastjet::PseudoJet>(const fastjet::ClusterSequence&)>& select_jets);
+
+#endif
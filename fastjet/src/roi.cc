@@ -0,0 +1,202 @@
+// roi.cc
+// MIT Licenced, Copyright (c) 2024 CERN
+//
+// Region of interest (RoI) restricted clustering, as done in a high
+// level trigger, where jets are only reconstructed around seeds
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <fstream>
+#include <iostream>
+#include <numeric>
+#include <sstream>
+
+#include "roi.hh"
+
+using namespace std;
+
+namespace {
+
+inline double delta_r2(double rap1, double phi1, double rap2, double phi2) {
+  auto dphi = std::fabs(phi1 - phi2);
+  if (dphi > fastjet::pi) dphi = fastjet::twopi - dphi;
+  auto drap = rap1 - rap2;
+  return drap * drap + dphi * dphi;
+}
+
+inline double phi_0_2pi(double phi) {
+  phi = std::fmod(phi, fastjet::twopi);
+  return phi < 0.0 ? phi + fastjet::twopi : phi;
+}
+
+}  // namespace
+
+std::vector<RoiSeed> leading_particle_seeds(const std::vector<fastjet::PseudoJet>& particles,
+                                            int n_seeds, double seed_ptmin, double min_separation) {
+  std::vector<size_t> order(particles.size());
+  std::iota(order.begin(), order.end(), 0);
+  std::sort(order.begin(), order.end(), [&](size_t a, size_t b) {
+    return particles[a].kt2() > particles[b].kt2();
+  });
+
+  std::vector<RoiSeed> seeds;
+  const auto min_sep2 = min_separation * min_separation;
+  for (auto i : order) {
+    if (int(seeds.size()) >= n_seeds) break;
+    const auto& p = particles[i];
+    if (p.kt2() < seed_ptmin * seed_ptmin) break;
+    bool separated = std::all_of(seeds.begin(), seeds.end(), [&](const RoiSeed& s) {
+      return delta_r2(p.rap(), p.phi(), s.rap, s.phi) >= min_sep2;
+    });
+    if (separated) seeds.push_back({p.rap(), p.phi()});
+  }
+  return seeds;
+}
+
+std::vector<std::vector<RoiSeed>> read_roi_seeds(const std::string& filename) {
+  std::vector<std::vector<RoiSeed>> seeds;
+  std::ifstream input(filename);
+  if (!input) {
+    cerr << "Failed to open RoI seed file " << filename << endl;
+    exit(EXIT_FAILURE);
+  }
+  std::string line;
+  while (std::getline(input, line)) {
+    if (line.empty() || line[0] == '#') continue;
+    std::istringstream ss(line);
+    size_t event;
+    RoiSeed seed;
+    if (!(ss >> event >> seed.rap >> seed.phi) || event == 0) {
+      cerr << "Bad line in RoI seed file " << filename << ": " << line << endl;
+      exit(EXIT_FAILURE);
+    }
+    seed.phi = phi_0_2pi(seed.phi);
+    if (seeds.size() < event) seeds.resize(event);
+    seeds[event - 1].push_back(seed);
+  }
+  return seeds;
+}
+
+void select_roi_particles(const std::vector<fastjet::PseudoJet>& particles,
+                          const std::vector<RoiSeed>& seeds, double radius,
+                          std::vector<fastjet::PseudoJet>& roi_particles) {
+  roi_particles.clear();
+  const auto radius2 = radius * radius;
+  for (const auto& p : particles) {
+    const auto rap = p.rap();
+    const auto phi = p.phi();
+    for (const auto& s : seeds) {
+      if (delta_r2(rap, phi, s.rap, s.phi) < radius2) {
+        roi_particles.push_back(p);
+        break;
+      }
+    }
+  }
+}
+
+std::vector<fastjet::PseudoJet> jets_near_seeds(const std::vector<fastjet::PseudoJet>& jets,
+                                                const std::vector<RoiSeed>& seeds,
+                                                double max_distance) {
+  std::vector<fastjet::PseudoJet> near;
+  const auto max_distance2 = max_distance * max_distance;
+  for (const auto& jet : jets) {
+    for (const auto& s : seeds) {
+      if (delta_r2(jet.rap(), jet.phi(), s.rap, s.phi) < max_distance2) {
+        near.push_back(jet);
+        break;
+      }
+    }
+  }
+  return near;
+}
+
+void run_roi_benchmark(const RoiOptions& options, size_t first_event, size_t n_events,
+                       const std::function<const std::vector<fastjet::PseudoJet>&(size_t)>& get_event,
+                       const std::vector<std::vector<RoiSeed>>& external_seeds,
+                       const fastjet::JetDefinition& jet_def) {
+  using clock = std::chrono::steady_clock;
+  const auto R = jet_def.R();
+
+  double time_roi = 0.0, time_select = 0.0, time_full = 0.0;
+  size_t n_particles = 0, n_roi_particles = 0, n_seeds = 0;
+  size_t n_roi_jets = 0, n_full_jets = 0, n_matched = 0;
+  double sum_dpt = 0.0, max_dpt = 0.0;
+
+  std::vector<fastjet::PseudoJet> roi_particles;
+  for (int trial = 0; trial < options.trials; ++trial) {
+    for (size_t ievt = first_event; ievt < n_events; ++ievt) {
+      const auto& particles = get_event(ievt);
+
+      // RoI path: seeding, particle selection and clustering are all part
+      // of the trigger cost
+      auto start_t = clock::now();
+      std::vector<RoiSeed> seeds;
+      if (external_seeds.empty()) {
+        seeds = leading_particle_seeds(particles, options.n_seeds, options.seed_ptmin, R);
+      } else if (ievt < external_seeds.size()) {
+        seeds = external_seeds[ievt];
+      }
+      select_roi_particles(particles, seeds, options.radius, roi_particles);
+      auto select_t = clock::now();
+      std::vector<fastjet::PseudoJet> roi_jets;
+      if (!roi_particles.empty()) {
+        fastjet::ClusterSequence roi_cs(roi_particles, jet_def);
+        roi_jets = jets_near_seeds(roi_cs.inclusive_jets(options.ptmin), seeds, R);
+      }
+      auto roi_t = clock::now();
+
+      // Full event reference
+      fastjet::ClusterSequence full_cs(particles, jet_def);
+      auto full_jets = jets_near_seeds(full_cs.inclusive_jets(options.ptmin), seeds, R);
+      auto full_t = clock::now();
+
+      time_select += std::chrono::duration<double, std::micro>(select_t - start_t).count();
+      time_roi += std::chrono::duration<double, std::micro>(roi_t - start_t).count();
+      time_full += std::chrono::duration<double, std::micro>(full_t - roi_t).count();
+
+      if (trial > 0) continue;
+      n_particles += particles.size();
+      n_roi_particles += roi_particles.size();
+      n_seeds += seeds.size();
+      n_roi_jets += roi_jets.size();
+      n_full_jets += full_jets.size();
+
+      // Match each full event jet to the closest RoI jet
+      for (const auto& full_jet : full_jets) {
+        double best_dr2 = 1.0e20;
+        const fastjet::PseudoJet* best = nullptr;
+        for (const auto& roi_jet : roi_jets) {
+          auto dr2 = full_jet.squared_distance(roi_jet);
+          if (dr2 < best_dr2) {
+            best_dr2 = dr2;
+            best = &roi_jet;
+          }
+        }
+        if (best && best_dr2 < 0.01 * R * R) {
+          ++n_matched;
+          auto dpt = std::fabs(best->pt() - full_jet.pt()) / full_jet.pt();
+          sum_dpt += dpt;
+          max_dpt = std::max(max_dpt, dpt);
+        }
+      }
+    }
+  }
+
+  const auto n_used = double(n_events - first_event);
+  const auto n_timed = n_used * options.trials;
+  cout << "RoI clustering: radius " << options.radius << ", "
+       << double(n_seeds) / n_used << " seeds per event" << endl;
+  cout << "Mean particles per event " << double(n_particles) / n_used
+       << ", in RoIs " << double(n_roi_particles) / n_used << endl;
+  cout << "RoI time per event " << time_roi / n_timed << " us (of which selection "
+       << time_select / n_timed << " us)" << endl;
+  cout << "Full event time per event " << time_full / n_timed << " us" << endl;
+  cout << "RoI / full time ratio " << time_roi / time_full << endl;
+  cout << "Jets near seeds: RoI " << n_roi_jets << ", full event " << n_full_jets
+       << ", matched " << n_matched << " (dR < 0.1 R)" << endl;
+  if (n_matched > 0) {
+    cout << "Matched jet relative pt difference: mean " << sum_dpt / n_matched
+         << ", max " << max_dpt << endl;
+  }
+}
@@ -0,0 +1,59 @@
+// roi.hh
+// MIT Licenced, Copyright (c) 2024 CERN
+//
+// Region of interest (RoI) restricted clustering, as done in a high
+// level trigger, where jets are only reconstructed around seeds
+
+#ifndef ROI_HH
+#define ROI_HH
+
+#include <functional>
+#include <string>
+#include <vector>
+
+#include "fastjet/ClusterSequence.hh"
+#include "fastjet/PseudoJet.hh"
+
+struct RoiSeed {
+  double rap;
+  double phi;
+};
+
+struct RoiOptions {
+  int n_seeds = 2;          // number of leading particles used as seeds
+  double seed_ptmin = 0.0;  // minimum pt for a particle seed
+  double radius = 1.0;      // particles within this distance of a seed are clustered
+  double ptmin = 0.0;       // inclusive jet pt cut
+  int trials = 1;
+};
+
+// Seeds from the highest pt particles of the event, skipping any particle
+// closer than min_separation to an already accepted seed
+std::vector<RoiSeed> leading_particle_seeds(const std::vector<fastjet::PseudoJet>& particles,
+                                            int n_seeds, double seed_ptmin, double min_separation);
+
+// Read externally supplied seeds from a text file with one "event rap phi"
+// line per seed, events counted from 1 (as in the jet dump); the returned
+// vector is indexed by event (from 0)
+std::vector<std::vector<RoiSeed>> read_roi_seeds(const std::string& filename);
+
+// Copy the particles within radius of any seed into roi_particles
+void select_roi_particles(const std::vector<fastjet::PseudoJet>& particles,
+                          const std::vector<RoiSeed>& seeds, double radius,
+                          std::vector<fastjet::PseudoJet>& roi_particles);
+
+// Jets whose axis lies within max_distance of a seed
+std::vector<fastjet::PseudoJet> jets_near_seeds(const std::vector<fastjet::PseudoJet>& jets,
+                                                const std::vector<RoiSeed>& seeds,
+                                                double max_distance);
+
+// Time RoI clustering over events first_event..n_events-1 (seeding,
+// particle selection and clustering) against full event clustering with
+// the same jet definition, and compare the jets found near the seeds. If
+// external_seeds is empty particle seeds are used.
+void run_roi_benchmark(const RoiOptions& options, size_t first_event, size_t n_events,
+                       const std::function<const std::vector<fastjet::PseudoJet>&(size_t)>& get_event,
+                       const std::vector<std::vector<RoiSeed>>& external_seeds,
+                       const fastjet::JetDefinition& jet_def);
+
+#endif
@@ -0,0 +1,83 @@
+// slow-events.cc
+// MIT Licenced, Copyright (c) 2024 CERN
+//
+// Capture of the slowest events of a run into a small replay file, and
+// per-event benchmarking of such a file
+
+#include <algorithm>
+#include <cmath>
+#include <iostream>
+#include <set>
+
+#include "HepMC3/GenEvent.h"
+#include "HepMC3/WriterAscii.h"
+
+#include "fastjet-utils.hh"
+#include "slow-events.hh"
+
+using namespace std;
+
+std::vector<SlowEvent> slowest_events(const std::vector<double>& event_us, const std::vector<size_t>& multiplicities,
+                                      size_t first_event, size_t k, bool per_particle) {
+  std::vector<SlowEvent> candidates;
+  for (size_t ievt = first_event; ievt < event_us.size(); ++ievt) {
+    candidates.push_back({ievt, event_us[ievt], multiplicities[ievt]});
+  }
+  auto key = [per_particle](const SlowEvent& e) {
+    return per_particle ? e.us / std::max<size_t>(e.n_particles, 1) : e.us;
+  };
+  k = std::min(k, candidates.size());
+  std::partial_sort(candidates.begin(), candidates.begin() + k, candidates.end(),
+                    [&](const SlowEvent& a, const SlowEvent& b) { return key(a) > key(b); });
+  candidates.resize(k);
+  return candidates;
+}
+
+long write_replay_file(const std::string& input_file, const std::string& replay_file,
+                       const std::vector<SlowEvent>& events) {
+  std::set<size_t> wanted;
+  for (const auto& e : events) wanted.insert(e.event);
+  if (wanted.empty()) return 0;
+
+  HepMC3::WriterAscii writer(replay_file);
+  if (writer.failed()) {
+    cerr << "Failed to open replay file " << replay_file << endl;
+    return -1;
+  }
+  // Events are written in input order; reading stops after the last one
+  long written = 0;
+  size_t ievt = 0;
+  for_each_input_event(input_file.c_str(), *wanted.rbegin() + 1, [&](const HepMC3::GenEvent& evt) {
+    if (wanted.count(ievt++)) {
+      writer.write_event(evt);
+      ++written;
+    }
+  });
+  writer.close();
+  return writer.failed() ? -1 : written;
+}
+
+void run_replay_benchmark(size_t first_event, const std::vector<size_t>& multiplicities,
+                          const std::vector<int>& event_numbers, int repeats,
+                          const std::function<double(size_t)>& process) {
+  repeats = std::max(repeats, 1);
+  cout << "Replaying " << multiplicities.size() - std::min(first_event, multiplicities.size()) << " events, " <<
+    repeats << " times each" << endl;
+  for (size_t ievt = first_event; ievt < multiplicities.size(); ++ievt) {
+    double total = 0.0;
+    double total2 = 0.0;
+    double lowest = 1.0e20;
+    for (int repeat = 0; repeat < repeats; ++repeat) {
+      auto us = process(ievt);
+      total += us;
+      total2 += us * us;
+      lowest = std::min(lowest, us);
+    }
+    auto mean = total / repeats;
+    auto sigma = repeats > 1 ? std::sqrt(std::max(double(repeats) / (repeats - 1) * (total2 / repeats - mean * mean), 0.0))
+                             : 0.0;
+    cout << "  event number " << event_numbers[ievt] << " (" << multiplicities[ievt] << " particles): " << mean << " +- " <<
+      sigma << " us, lowest " << lowest << " us, " << lowest / std::max<size_t>(multiplicities[ievt], 1) <<
+      " us per particle" << endl;
+  }
+}
@@ -0,0 +1,39 @@
+// slow-events.hh
+// MIT Licenced, Copyright (c) 2024 CERN
+//
+// Capture of the slowest events of a run into a small replay file, and
+// per-event benchmarking of such a file
+
+#ifndef SLOW_EVENTS_HH
+#define SLOW_EVENTS_HH
+
+#include <functional>
+#include <string>
+#include <vector>
+
+struct SlowEvent {
+  size_t event;        // index in the input file, counted from 0
+  double us;           // lowest time over the trials
+  size_t n_particles;
+};
+
+// The k slowest of events first_event..event_us.size()-1, slowest first;
+// with per_particle, events are ranked by time divided by multiplicity
+std::vector<SlowEvent> slowest_events(const std::vector<double>& event_us, const std::vector<size_t>& multiplicities,
+                                      size_t first_event, size_t k, bool per_particle = false);
+
+// Copy the given events (indexes counted from 0) of a HepMC3 file, as they
+// are, to a new HepMC3 file; returns the number of events written, or -1
+// if the replay file could not be written
+long write_replay_file(const std::string& input_file, const std::string& replay_file,
+                       const std::vector<SlowEvent>& events);
+
+// Run each of events first_event..multiplicities.size()-1 repeats times in
+// a row and print its mean, spread and lowest time, labelled with its
+// HepMC3 event number from event_numbers. process(ievt) runs one event and
+// returns its timed part in us.
+void run_replay_benchmark(size_t first_event, const std::vector<size_t>& multiplicities,
+                          const std::vector<int>& event_numbers, int repeats,
+                          const std::function<double(size_t)>& process);
+
+#endif
@@ -0,0 +1,187 @@
+// soak.cc
+// MIT Licenced, Copyright (c) 2024 CERN
+//
+// Long duration running of the clustering, sampling memory use, heap
+// statistics, throughput and latency to look for leaks and drifts
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <vector>
+
+#include <malloc.h>
+#include <unistd.h>
+
+#include "soak.hh"
+
+namespace {
+
+// Interval statistics for the drift analysis
+struct SoakSample {
+  double elapsed_s;
+  MemorySample memory;
+  double throughput;  // events per second over the interval
+};
+
+// Thresholds used to flag drifts over the run
+constexpr double kRssGrowthFraction = 0.05;   // RSS increase, end vs. start
+constexpr double kThroughputDecay = 0.05;     // throughput decrease, last vs. first quarter
+
+// Least squares slope of y against x
+double slope(const std::vector<double>& x, const std::vector<double>& y) {
+  auto n = double(x.size());
+  double sx = 0.0, sy = 0.0, sxx = 0.0, sxy = 0.0;
+  for (size_t i = 0; i < x.size(); ++i) {
+    sx += x[i];
+    sy += y[i];
+    sxx += x[i] * x[i];
+    sxy += x[i] * y[i];
+  }
+  auto denom = n * sxx - sx * sx;
+  return denom != 0.0 ? (n * sxy - sx * sy) / denom : 0.0;
+}
+
+double mean_throughput(std::vector<SoakSample>::const_iterator begin,
+                       std::vector<SoakSample>::const_iterator end) {
+  double sum = 0.0;
+  for (auto it = begin; it != end; ++it) sum += it->throughput;
+  return sum / std::max<long>(1, end - begin);
+}
+
+}  // namespace
+
+double MemorySample::fragmentation() const {
+  // Fraction of the heap held by the allocator but not in use
+  auto total = heap_in_use + heap_free;
+  return total > 0 ? double(heap_free) / total : 0.0;
+}
+
+MemorySample sample_memory() {
+  MemorySample sample;
+
+  // Resident set size, in pages, is the second field of statm
+  if (auto statm = fopen("/proc/self/statm", "r")) {
+    long size_pages = 0, rss_pages = 0;
+    if (fscanf(statm, "%ld %ld", &size_pages, &rss_pages) == 2) {
+      sample.rss_kb = rss_pages * (sysconf(_SC_PAGESIZE) / 1024);
+    }
+    fclose(statm);
+  }
+
+#if defined(__GLIBC__) && (__GLIBC__ > 2 || (__GLIBC__ == 2 && __GLIBC_MINOR__ >= 33))
+  auto info = mallinfo2();
+  sample.heap_in_use = info.uordblks;
+  sample.heap_free = info.fordblks;
+  sample.heap_mmap = info.hblkhd;
+#elif defined(__GLIBC__)
+  // mallinfo counters are int, so wrap for heaps above 2GB
+  auto info = mallinfo();
+  sample.heap_in_use = size_t(unsigned(info.uordblks));
+  sample.heap_free = size_t(unsigned(info.fordblks));
+  sample.heap_mmap = size_t(unsigned(info.hblkhd));
+#endif
+
+  return sample;
+}
+
+bool run_soak(const SoakOptions& options, size_t n_events,
+              const std::function<void(size_t, size_t)>& process, FILE* report) {
+  using clock = std::chrono::steady_clock;
+  if (options.first_event >= n_events || options.n_configs == 0) return false;
+
+  std::vector<SoakSample> samples;
+  std::vector<double> latencies_us;
+
+  fprintf(report, "elapsed_s,events,config,rss_kb,heap_in_use,heap_free,heap_mmap,fragmentation,"
+                  "event_rate,mean_latency_us,p99_latency_us,max_latency_us\n");
+
+  const auto start_t = clock::now();
+  auto interval_start_t = start_t;
+  size_t total_events = 0;
+  size_t interval_events = 0;
+  size_t ievt = options.first_event;
+  size_t iconfig = 0;
+  bool done = false;
+
+  while (!done) {
+    auto event_start_t = clock::now();
+    process(ievt, iconfig);
+    auto event_stop_t = clock::now();
+    latencies_us.push_back(std::chrono::duration<double, std::micro>(event_stop_t - event_start_t).count());
+    ++total_events;
+    ++interval_events;
+
+    if (++ievt == n_events) {
+      ievt = options.first_event;
+      iconfig = (iconfig + 1) % options.n_configs;
+    }
+
+    // The duration is checked after every event; a sample is taken at the
+    // end of each interval and a final one when the time is up
+    auto elapsed_s = std::chrono::duration<double>(event_stop_t - start_t).count();
+    done = elapsed_s >= options.duration_s;
+    auto interval_s = std::chrono::duration<double>(event_stop_t - interval_start_t).count();
+    if (!done && interval_s < options.interval_s) continue;
+
+    SoakSample sample{elapsed_s, sample_memory(), interval_events / interval_s};
+    samples.push_back(sample);
+
+    double sum = 0.0;
+    for (auto l : latencies_us) sum += l;
+    auto p99 = latencies_us.begin() + size_t(0.99 * (latencies_us.size() - 1));
+    std::nth_element(latencies_us.begin(), p99, latencies_us.end());
+    auto p99_latency = *p99;
+    auto max_latency = *std::max_element(p99, latencies_us.end());
+
+    fprintf(report, "%.1f,%zu,%zu,%ld,%zu,%zu,%zu,%.4f,%.2f,%.3f,%.3f,%.3f\n",
+            elapsed_s, total_events, iconfig, sample.memory.rss_kb, sample.memory.heap_in_use,
+            sample.memory.heap_free, sample.memory.heap_mmap, sample.memory.fragmentation(),
+            sample.throughput, sum / latencies_us.size(), p99_latency, max_latency);
+    fflush(report);
+
+    latencies_us.clear();
+    interval_events = 0;
+    interval_start_t = clock::now();
+  }
+
+  // Drift analysis, ignoring the first interval, which includes warm up
+  bool ok = true;
+  if (samples.size() < 3) {
+    fprintf(report, "# Too few samples (%zu) for drift analysis\n", samples.size());
+    return ok;
+  }
+  std::vector<SoakSample> steady(samples.begin() + 1, samples.end());
+  std::vector<double> hours, rss, rate;
+  for (const auto& s : steady) {
+    hours.push_back(s.elapsed_s / 3600.0);
+    rss.push_back(s.memory.rss_kb);
+    rate.push_back(s.throughput);
+  }
+
+  auto rss_growth = (rss.back() - rss.front()) / rss.front();
+  // Monotonic growth: never decreasing, and increasing in most intervals
+  size_t n_increases = 0;
+  for (size_t i = 1; i < rss.size(); ++i) n_increases += rss[i] > rss[i - 1];
+  bool rss_monotonic = rss.size() >= 4 && std::is_sorted(rss.begin(), rss.end()) &&
+                       2 * n_increases >= rss.size() - 1;
+  fprintf(report, "# RSS %.0f -> %.0f kB (%+.2f%%), slope %.1f kB/hour%s\n",
+          rss.front(), rss.back(), 100.0 * rss_growth, slope(hours, rss),
+          rss_monotonic ? ", monotonic growth" : "");
+  if (rss_monotonic || rss_growth > kRssGrowthFraction) {
+    fprintf(report, "# WARNING: memory growth detected\n");
+    ok = false;
+  }
+
+  auto quarter = std::max<size_t>(1, steady.size() / 4);
+  auto first_rate = mean_throughput(steady.begin(), steady.begin() + quarter);
+  auto last_rate = mean_throughput(steady.end() - quarter, steady.end());
+  auto rate_change = (last_rate - first_rate) / first_rate;
+  fprintf(report, "# Throughput %.2f -> %.2f events/s (%+.2f%%), slope %.2f events/s/hour\n",
+          first_rate, last_rate, 100.0 * rate_change, slope(hours, rate));
+  if (rate_change < -kThroughputDecay) {
+    fprintf(report, "# WARNING: throughput decay detected\n");
+    ok = false;
+  }
+
+  return ok;
+}
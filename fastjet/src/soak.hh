@@ -0,0 +1,41 @@
+// soak.hh
+// MIT Licenced, Copyright (c) 2024 CERN
+//
+// Long duration running of the clustering, sampling memory use, heap
+// statistics, throughput and latency to look for leaks and drifts
+
+#ifndef SOAK_HH
+#define SOAK_HH
+
+#include <cstdio>
+#include <functional>
+
+struct SoakOptions {
+  double duration_s = 3600.0;  // total running time
+  double interval_s = 60.0;    // time between samples
+  size_t n_configs = 1;        // number of configurations cycled through
+  size_t first_event = 0;      // events before this one are skipped
+};
+
+// Process memory and heap state at one point in time
+struct MemorySample {
+  long rss_kb = 0;
+  size_t heap_in_use = 0;  // bytes in allocated chunks
+  size_t heap_free = 0;    // bytes in free chunks held by the allocator
+  size_t heap_mmap = 0;    // bytes in mmapped chunks
+  double fragmentation() const;
+};
+
+MemorySample sample_memory();
+
+// Run process(ievt, iconfig) repeatedly, cycling through events
+// first_event..n_events-1 and switching configuration after each full
+// pass, until the requested duration is reached (checked after every
+// event). One CSV line is written to report per interval, and for the last
+// partial interval, and a summary with any detected drift at the end.
+// Returns true if no drift was flagged, and false at once if there are no
+// events to process.
+bool run_soak(const SoakOptions& options, size_t n_events,
+              const std::function<void(size_t, size_t)>& process, FILE* report);
+
+#endif
@@ -0,0 +1,141 @@
+// subsample.cc
+// MIT Licenced, Copyright (c) 2024 CERN
+//
+// Fast estimate of the time per event from a stratified subsample of the
+// input events, with strata in particle multiplicity
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <iostream>
+#include <numeric>
+#include <random>
+
+#include "subsample.hh"
+
+using namespace std;
+
+std::vector<std::vector<size_t>> multiplicity_strata(const std::vector<size_t>& event_indexes,
+                                                     const std::vector<size_t>& multiplicities,
+                                                     int n_strata) {
+  auto order = event_indexes;
+  std::stable_sort(order.begin(), order.end(), [&](size_t a, size_t b) {
+    return multiplicities[a] < multiplicities[b];
+  });
+
+  std::vector<std::vector<size_t>> strata;
+  n_strata = std::max(n_strata, 1);
+  size_t begin = 0;
+  for (int istratum = 1; istratum <= n_strata && begin < order.size(); ++istratum) {
+    size_t end = order.size() * istratum / n_strata;
+    if (end <= begin) continue;
+    // Keep runs of equal multiplicity together
+    while (end < order.size() && multiplicities[order[end]] == multiplicities[order[end - 1]]) ++end;
+    strata.emplace_back(order.begin() + begin, order.begin() + end);
+    begin = end;
+  }
+  return strata;
+}
+
+std::vector<std::vector<size_t>> stratified_sample(const std::vector<std::vector<size_t>>& strata,
+                                                   double fraction, unsigned int seed) {
+  std::mt19937 rng(seed);
+  std::vector<std::vector<size_t>> samples;
+  for (const auto& stratum : strata) {
+    auto n_sample = size_t(std::lround(fraction * stratum.size()));
+    n_sample = std::min(std::max(n_sample, size_t(2)), stratum.size());
+    auto sample = stratum;
+    std::shuffle(sample.begin(), sample.end(), rng);
+    sample.resize(n_sample);
+    // Process sampled events in file order, as in a full run
+    std::sort(sample.begin(), sample.end());
+    samples.push_back(std::move(sample));
+  }
+  return samples;
+}
+
+SubsampleEstimate stratified_estimate(const std::vector<std::vector<size_t>>& strata,
+                                      const std::vector<std::vector<double>>& sample_times) {
+  SubsampleEstimate estimate;
+  size_t n_total = 0;
+  for (const auto& stratum : strata) n_total += stratum.size();
+  if (n_total == 0) return estimate;
+
+  double variance = 0.0;
+  for (size_t h = 0; h < strata.size(); ++h) {
+    const auto& times = sample_times[h];
+    const auto n = times.size();
+    if (n == 0) continue;
+    const auto weight = double(strata[h].size()) / n_total;
+    const auto mean = std::accumulate(times.begin(), times.end(), 0.0) / n;
+    estimate.mean_us += weight * mean;
+    estimate.n_sampled += n;
+    if (n > 1) {
+      double s2 = 0.0;
+      for (auto t : times) s2 += (t - mean) * (t - mean);
+      s2 /= n - 1;
+      variance += weight * weight * (1.0 - double(n) / strata[h].size()) * s2 / n;
+    }
+  }
+  estimate.error_us = std::sqrt(variance);
+  return estimate;
+}
+
+SubsampleEstimate run_subsample_estimate(const SubsampleOptions& options, size_t first_event,
+                                         const std::vector<size_t>& multiplicities,
+                                         const std::function<double(size_t)>& process) {
+  using clock = std::chrono::steady_clock;
+
+  std::vector<size_t> event_indexes;
+  for (size_t ievt = first_event; ievt < multiplicities.size(); ++ievt) event_indexes.push_back(ievt);
+  auto strata = multiplicity_strata(event_indexes, multiplicities, options.n_strata);
+  auto samples = stratified_sample(strata, options.fraction, options.seed);
+
+  // Per event times are averaged over the trials
+  std::vector<std::vector<double>> sample_times(samples.size());
+  for (size_t h = 0; h < samples.size(); ++h) sample_times[h].assign(samples[h].size(), 0.0);
+  auto start_t = clock::now();
+  for (int trial = 0; trial < options.trials; ++trial) {
+    for (size_t h = 0; h < samples.size(); ++h) {
+      for (size_t i = 0; i < samples[h].size(); ++i) {
+        sample_times[h][i] += process(samples[h][i]);
+      }
+    }
+  }
+  auto sample_wall = std::chrono::duration<double>(clock::now() - start_t).count();
+  for (auto& times : sample_times) {
+    for (auto& t : times) t /= options.trials;
+  }
+
+  auto estimate = stratified_estimate(strata, sample_times);
+
+  cout << "Stratified subsample: " << estimate.n_sampled << " of " << event_indexes.size()
+       << " events in " << strata.size() << " multiplicity strata" << endl;
+  for (size_t h = 0; h < strata.size(); ++h) {
+    const auto& times = sample_times[h];
+    cout << "  multiplicity " << multiplicities[strata[h].front()] << "-"
+         << multiplicities[strata[h].back()] << ": " << samples[h].size() << " of "
+         << strata[h].size() << " events, "
+         << std::accumulate(times.begin(), times.end(), 0.0) / times.size() << " us per event" << endl;
+  }
+  cout << "Estimated time per event " << estimate.mean_us << " +- " << estimate.error_us << " us" << endl;
+  cout << "Estimate took " << sample_wall << " s" << endl;
+
+  if (options.validate) {
+    double full_total = 0.0;
+    start_t = clock::now();
+    for (int trial = 0; trial < options.trials; ++trial) {
+      for (auto ievt : event_indexes) full_total += process(ievt);
+    }
+    auto full_wall = std::chrono::duration<double>(clock::now() - start_t).count();
+    auto full_mean = full_total / options.trials / event_indexes.size();
+    auto deviation = estimate.mean_us - full_mean;
+    cout << "Full run time per event " << full_mean << " us (took " << full_wall << " s, "
+         << full_wall / sample_wall << "x the estimate)" << endl;
+    cout << "Estimate deviation " << deviation << " us (" << 100.0 * deviation / full_mean << "%";
+    if (estimate.error_us > 0.0) cout << ", " << deviation / estimate.error_us << " sigma";
+    cout << ")" << endl;
+  }
+
+  return estimate;
+}
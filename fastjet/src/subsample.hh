@@ -0,0 +1,52 @@
+// subsample.hh
+// MIT Licenced, Copyright (c) 2024 CERN
+//
+// Fast estimate of the time per event from a stratified subsample of the
+// input events, with strata in particle multiplicity
+
+#ifndef SUBSAMPLE_HH
+#define SUBSAMPLE_HH
+
+#include <functional>
+#include <vector>
+
+struct SubsampleOptions {
+  double fraction = 0.1;  // fraction of the events to time
+  int n_strata = 8;       // number of multiplicity strata
+  int trials = 1;         // repeated timings of each sampled event
+  unsigned int seed = 1;  // random seed for the event choice
+  bool validate = false;  // also time every event and compare
+};
+
+struct SubsampleEstimate {
+  double mean_us = 0.0;   // estimated time per event
+  double error_us = 0.0;  // standard error of the estimate
+  size_t n_sampled = 0;
+};
+
+// Partition the events (given as indexes) into strata of roughly equal
+// size by ascending multiplicity; events of equal multiplicity are never
+// split across strata
+std::vector<std::vector<size_t>> multiplicity_strata(const std::vector<size_t>& event_indexes,
+                                                     const std::vector<size_t>& multiplicities,
+                                                     int n_strata);
+
+// Choose events from each stratum at random, in proportion to the stratum
+// size, but at least two per stratum (when available) so that the
+// variance of each stratum can be estimated
+std::vector<std::vector<size_t>> stratified_sample(const std::vector<std::vector<size_t>>& strata,
+                                                   double fraction, unsigned int seed);
+
+// Stratified estimate of the mean over all events, from the times of the
+// sampled events, with the finite population correction
+SubsampleEstimate stratified_estimate(const std::vector<std::vector<size_t>>& strata,
+                                      const std::vector<std::vector<double>>& sample_times);
+
+// Time a stratified subsample of events first_event..multiplicities.size()-1
+// and print the estimated time per event for the whole file. process(ievt)
+// runs one event and returns its timed part in us.
+SubsampleEstimate run_subsample_estimate(const SubsampleOptions& options, size_t first_event,
+                                         const std::vector<size_t>& multiplicities,
+                                         const std::function<double(size_t)>& process);
+
+#endif
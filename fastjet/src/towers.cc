@@ -0,0 +1,45 @@
+// towers.cc
+// MIT Licenced, Copyright (c) 2024 CERN
+//
+// Projection of the input particles onto a calorimeter tower grid before
+// clustering
+
+#include <algorithm>
+#include <cmath>
+
+#include "towers.hh"
+
+void calorimeter_towers(std::vector<fastjet::PseudoJet>& particles, double tower_size, double etamax) {
+  auto neta = std::max(1, int(std::ceil(2.0 * etamax / tower_size)));
+  auto nphi = std::max(1, int(std::round(fastjet::twopi / tower_size)));
+  auto eta_width = 2.0 * etamax / neta;
+  auto phi_width = fastjet::twopi / nphi;
+
+  // Energy per cell, reset after each event through the list of hit cells,
+  // so that the cost does not depend on the grid size
+  thread_local std::vector<double> energy;
+  thread_local std::vector<int> hit;
+  if (energy.size() != size_t(neta * nphi)) energy.assign(neta * nphi, 0.0);
+  hit.clear();
+  for (const auto& p : particles) {
+    if (p.pt2() == 0.0) continue;
+    auto eta = p.eta();
+    if (std::fabs(eta) >= etamax) continue;
+    auto ieta = std::min(int((eta + etamax) / eta_width), neta - 1);
+    auto iphi = std::min(int(p.phi() / phi_width), nphi - 1);
+    auto cell = ieta * nphi + iphi;
+    if (energy[cell] == 0.0) hit.push_back(cell);
+    energy[cell] += p.E();
+  }
+
+  particles.clear();
+  for (auto cell : hit) {
+    auto E = energy[cell];
+    energy[cell] = 0.0;
+    auto eta = -etamax + (cell / nphi + 0.5) * eta_width;
+    auto phi = (cell % nphi + 0.5) * phi_width;
+    auto pt = E / std::cosh(eta);
+    particles.emplace_back(pt * std::cos(phi), pt * std::sin(phi), pt * std::sinh(eta), E);
+    particles.back().set_user_index(particles.size() - 1);
+  }
+}
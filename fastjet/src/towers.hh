@@ -0,0 +1,23 @@
+// towers.hh
+// MIT Licenced, Copyright (c) 2024 CERN
+//
+// Projection of the input particles onto a calorimeter tower grid before
+// clustering
+
+#ifndef TOWERS_HH
+#define TOWERS_HH
+
+#include <vector>
+
+#include "fastjet/PseudoJet.hh"
+
+// Replace the particles by towers of an (eta, phi) grid within |eta| <
+// etamax, with cells tower_size wide in eta and about tower_size in phi
+// (2pi is divided into a whole number of cells). The energies of the
+// particles in each cell are summed, and each tower becomes a massless
+// four-vector pointing at the centre of its cell; particles outside the
+// grid are dropped. Towers come in the order in which they were first hit,
+// with the user index set to their position.
+void calorimeter_towers(std::vector<fastjet::PseudoJet>& particles, double tower_size, double etamax);
+
+#endif
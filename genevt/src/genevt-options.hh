@@ -0,0 +1,62 @@
+// Simple command line options for the event generators, given as
+// "--name value" pairs.
+
+#ifndef GENEVT_OPTIONS_HH
+#define GENEVT_OPTIONS_HH
+
+#include <cstdlib>
+#include <iostream>
+#include <map>
+#include <set>
+#include <sstream>
+#include <string>
+
+class GenOptions {
+public:
+  // Parse arguments, accepting only the given option names; on any error,
+  // or for --help, print the usage text and exit
+  GenOptions(int argc, char* argv[], const std::set<std::string>& known,
+             const std::string& usage) {
+    for (int i = 1; i < argc; ++i) {
+      std::string arg = argv[i];
+      if (arg == "-h" || arg == "--help") {
+        std::cout << usage << std::endl;
+        std::exit(EXIT_SUCCESS);
+      }
+      if (arg.rfind("--", 0) != 0 || i + 1 >= argc || !known.count(arg.substr(2))) {
+        std::cerr << "Bad argument: " << arg << "\n" << usage << std::endl;
+        std::exit(EXIT_FAILURE);
+      }
+      values[arg.substr(2)] = argv[++i];
+    }
+  }
+
+  bool has(const std::string& name) const { return values.count(name) > 0; }
+
+  std::string get(const std::string& name, const std::string& fallback) const {
+    auto it = values.find(name);
+    return it == values.end() ? fallback : it->second;
+  }
+
+  double get(const std::string& name, double fallback) const {
+    auto it = values.find(name);
+    return it == values.end() ? fallback : std::stod(it->second);
+  }
+
+  int get(const std::string& name, int fallback) const {
+    auto it = values.find(name);
+    return it == values.end() ? fallback : std::stoi(it->second);
+  }
+
+private:
+  std::map<std::string, std::string> values;
+};
+
+// Format a number for use in a file name, without trailing zeros
+inline std::string number_label(double value) {
+  std::ostringstream ss;
+  ss << value;
+  return ss.str();
+}
+
+#endif
@@ -5,24 +5,95 @@
 
 // Authors: Mikhail Kirsanov <Mikhail.Kirsanov@cern.ch>.
 
+#include <cmath>
+#include <map>
+
 #include "Pythia8/Pythia.h"
 #include "Pythia8Plugins/HepMC3.h"
 
+#include "genevt-options.hh"
+
 using namespace Pythia8;
 
-int main() {
+const std::string usage = R"(genevts-AA [options]
+
+  --system arg     Collision system: AuAu (default), PbPb, XeXe, CuCu, ArAr,
+                   OO or pPb
+  --ecm arg        Centre of mass energy per nucleon pair in GeV (default 2760)
+  --cmin arg       Minimum centrality in percent (default 0)
+  --cmax arg       Maximum centrality in percent (default 100)
+  --bmin arg       Minimum impact parameter in fm (overrides cmin)
+  --bmax arg       Maximum impact parameter in fm (overrides cmax)
+  --nevents arg    Number of events (default 100)
+  --output arg     Output HepMC3 file (default derived from the options)
+
+Events outside the impact parameter range are generated and discarded.
+Centrality is converted to impact parameter with the geometric (sharp
+sphere) approximation, c = b^2 / (R_A + R_B)^2 with R = 1.2 A^(1/3) + 0.5 fm,
+which is good to about 1 fm; use bmin and bmax for exact ranges.)";
+
+// Beam particle code and mass number of the nucleus for each system
+struct Nucleus {
+  int id;
+  int A;
+};
+
+const std::map<std::string, std::pair<Nucleus, Nucleus>> systems = {
+    {"AuAu", {{1000791970, 197}, {1000791970, 197}}},
+    {"PbPb", {{1000822080, 208}, {1000822080, 208}}},
+    {"XeXe", {{1000541290, 129}, {1000541290, 129}}},
+    {"CuCu", {{1000290630, 63}, {1000290630, 63}}},
+    {"ArAr", {{1000180400, 40}, {1000180400, 40}}},
+    {"OO", {{1000080160, 16}, {1000080160, 16}}},
+    {"pPb", {{2212, 1}, {1000822080, 208}}},
+};
+
+double nuclear_radius(int A) { return 1.2 * std::cbrt(double(A)) + 0.5; }
+
+int main(int argc, char* argv[]) {
+
+  GenOptions options(argc, argv, {"system", "ecm", "cmin", "cmax", "bmin", "bmax", "nevents", "output"}, usage);
+  auto system = options.get("system", std::string("AuAu"));
+  auto ecm = options.get("ecm", 2760.0);
+  auto cmin = options.get("cmin", 0.0);
+  auto cmax = options.get("cmax", 100.0);
+  auto nevents = options.get("nevents", 100);
+
+  auto beams = systems.find(system);
+  if (beams == systems.end()) {
+    std::cerr << "Unknown collision system: " << system << "\n" << usage << std::endl;
+    return EXIT_FAILURE;
+  }
+  if (cmin < 0.0 || cmax > 100.0 || cmin >= cmax) {
+    std::cerr << "Bad centrality range: " << cmin << " to " << cmax << "\n" << usage << std::endl;
+    return EXIT_FAILURE;
+  }
+  auto b_edge = nuclear_radius(beams->second.first.A) + nuclear_radius(beams->second.second.A);
+  auto bmin = options.get("bmin", b_edge * std::sqrt(cmin / 100.0));
+  auto bmax = options.get("bmax", cmax < 100.0 ? b_edge * std::sqrt(cmax / 100.0) : 1.0e9);
+
+  // Default file name follows the existing samples, e.g.,
+  // events-PbPb-5.02TeV-c0-10.hepmc3 or events-AuAu-2.76TeV.hepmc3
+  std::string range_label;
+  if (options.has("bmin") || options.has("bmax")) {
+    range_label = "-b" + number_label(bmin) + "-" + (options.has("bmax") ? number_label(bmax) : "inf");
+  } else if (cmin > 0.0 || cmax < 100.0) {
+    range_label = "-c" + number_label(cmin) + "-" + number_label(cmax);
+  }
+  auto output = options.get("output", "events-" + system + "-" + number_label(ecm / 1000.0) + "TeV" +
+                                      range_label + ".hepmc3");
 
   // Interface for conversion from Pythia8::Event to HepMC
   // event. Specify file where HepMC events will be stored.
-  Pythia8::Pythia8ToHepMC topHepMC("events-AuAu.hepmc3");
+  Pythia8::Pythia8ToHepMC topHepMC(output);
 
   // Generator. Process selection. LHC initialization. Histogram.
   Pythia pythia;
 
   // Setup the beams.
-  pythia.readString("Beams:idA = 1000791970");
-  pythia.readString("Beams:idB = 1000791970"); // The lead ions.
-  pythia.readString("Beams:eCM = 2760.0");
+  pythia.readString("Beams:idA = " + std::to_string(beams->second.first.id));
+  pythia.readString("Beams:idB = " + std::to_string(beams->second.second.id));
+  pythia.readString("Beams:eCM = " + std::to_string(ecm));
   pythia.readString("Beams:frameType = 1");
 
   // Initialize the Angantyr model to fit the total and semi-inclusive
@@ -37,11 +108,19 @@ int main() {
   pythia.readString("HeavyIon:SigFitNGen = 20");
 
   pythia.init();
-  Hist mult("charged multiplicity", 100, -0.5, 799.5);
+  Hist mult("charged multiplicity", 100, -0.5, 39999.5);
+  Hist impact("impact parameter (fm)", 40, 0.0, 20.0);
 
-  // Begin event loop. Generate event. Skip if error.
-  for (int iEvent = 0; iEvent < 100; ++iEvent) {
+  // Begin event loop. Generate event. Skip if error, or outside the
+  // impact parameter range.
+  long nTried = 0;
+  for (int iEvent = 0; iEvent < nevents;) {
     if (!pythia.next()) continue;
+    ++nTried;
+    auto b = pythia.info.hiInfo->b();
+    if (b < bmin || b >= bmax) continue;
+    ++iEvent;
+    impact.fill(b);
 
     // Find number of all final charged particles and fill histogram.
     int nCharged = 0;
@@ -57,7 +136,9 @@ int main() {
   // End of event loop. Statistics. Histogram.
   }
   pythia.stat();
-  cout << mult;
+  cout << mult << impact;
+  cout << "Accepted " << nevents << " of " << nTried << " events with " << bmin << " <= b < " << bmax <<
+    " fm" << endl;
 
   // Done.
   return 0;
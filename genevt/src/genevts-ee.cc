@@ -5,16 +5,52 @@
 
 // Authors: Mikhail Kirsanov <Mikhail.Kirsanov@cern.ch>.
 
+#include <random>
+
 #include "Pythia8/Pythia.h"
 #include "Pythia8Plugins/HepMC3.h"
 
+#include "genevt-options.hh"
+
 using namespace Pythia8;
 
-int main() {
+const std::string usage = R"(genevts-ee [options]
+
+  --process arg    Z (default), WW, ZZ or tt
+  --ecm arg        Centre of mass energy in GeV (default 120), e.g., 91.2,
+                   240 or 365 for circular colliders, 1500 or 3000 for
+                   linear colliders
+  --overlay arg    Mean number of gamma gamma -> hadrons background events
+                   overlaid on each event, Poisson distributed (default 0)
+  --seed arg       Random seed for the number of overlaid events (default 1)
+  --nevents arg    Number of events (default 100)
+  --output arg     Output HepMC3 file (default derived from the options)
+
+All processes decay hadronically: Z/gamma* -> qqbar, WW and ZZ with both
+bosons decaying to quarks and ttbar with both W bosons decaying to quarks.
+The overlaid gamma gamma -> hadrons events come from a second generator,
+with photons from the equivalent photon approximation for the beams (no
+beamstrahlung), and are added to the hard event before writing it out.)";
+
+int main(int argc, char* argv[]) {
+
+  GenOptions options(argc, argv, {"process", "ecm", "overlay", "seed", "nevents", "output"}, usage);
+  auto process = options.get("process", std::string("Z"));
+  auto ecm = options.get("ecm", 120.0);
+  auto overlay = options.get("overlay", 0.0);
+  auto seed = options.get("seed", 1);
+  auto nevents = options.get("nevents", 100);
+
+  // Default file name follows the existing samples, e.g.,
+  // events-ee-120.hepmc3 or events-ee-tt-365-gg0.5.hepmc3
+  std::string process_label = process == "Z" ? "" : "-" + process;
+  std::string overlay_label = overlay > 0.0 ? "-gg" + number_label(overlay) : "";
+  auto output = options.get("output", "events-ee" + process_label + "-" + number_label(ecm) +
+                                      overlay_label + ".hepmc3");
 
   // Interface for conversion from Pythia8::Event to HepMC
   // event. Specify file where HepMC events will be stored.
-  Pythia8::Pythia8ToHepMC topHepMC("events-ee-120.hepmc3");
+  Pythia8::Pythia8ToHepMC topHepMC(output);
 
   // Generator. Process selection. LHC initialization. Histogram.
   Pythia pythia;
@@ -22,28 +58,75 @@ int main() {
   // Allow no substructure in e+- beams: normal for corrected LEP data.
   pythia.readString("PDF:lepton = off");
   // Process selection.
-  pythia.readString("WeakSingleBoson:ffbar2gmZ = on");
-  // Switch off all Z0 decays and then switch back on those to quarks.
-  pythia.readString("23:onMode = off");
-  pythia.readString("23:onIfAny = 1 2 3 4 5");
+  if (process == "Z") {
+    pythia.readString("WeakSingleBoson:ffbar2gmZ = on");
+    // Switch off all Z0 decays and then switch back on those to quarks.
+    pythia.readString("23:onMode = off");
+    pythia.readString("23:onIfAny = 1 2 3 4 5");
+  } else if (process == "WW") {
+    pythia.readString("WeakDoubleBoson:ffbar2WW = on");
+    pythia.readString("24:onMode = off");
+    pythia.readString("24:onIfAny = 1 2 3 4 5");
+  } else if (process == "ZZ") {
+    // Pure Z (no gamma*) pairs
+    pythia.readString("WeakDoubleBoson:ffbar2gmZgmZ = on");
+    pythia.readString("WeakZ0:gmZmode = 2");
+    pythia.readString("23:onMode = off");
+    pythia.readString("23:onIfAny = 1 2 3 4 5");
+  } else if (process == "tt") {
+    pythia.readString("Top:ffbar2ttbar(s:gmZ) = on");
+    pythia.readString("24:onMode = off");
+    pythia.readString("24:onIfAny = 1 2 3 4 5");
+  } else {
+    std::cerr << "Unknown process: " << process << "\n" << usage << std::endl;
+    return EXIT_FAILURE;
+  }
 
   // e+e- beams
   pythia.readString("Beams:idA =  11");
   pythia.readString("Beams:idB = -11");
-  
-  // Can set beam energy here, like this:
-  // double mZ = pythia.particleData.m0(23);
-  // pythia.settings.parm("Beams:eCM", mZ);
-  // Or with a manual valus
-  pythia.readString("Beams:eCM = 120.");
+  pythia.readString("Beams:eCM = " + std::to_string(ecm));
 
   pythia.init();
+
+  // Background generator: hadronic interactions of (quasi-real) photons
+  // radiated by both beams
+  Pythia background;
+  std::mt19937 rng(seed);
+  std::poisson_distribution<int> n_overlay_dist(overlay > 0.0 ? overlay : 1.0);
+  if (overlay > 0.0) {
+    background.readString("Beams:idA =  11");
+    background.readString("Beams:idB = -11");
+    background.readString("Beams:eCM = " + std::to_string(ecm));
+    background.readString("PDF:lepton2gamma = on");
+    background.readString("Photon:ProcessType = 1");
+    background.readString("Photon:Q2max = 1.0");
+    background.readString("Photon:Wmin = 2.0");
+    background.readString("SoftQCD:nonDiffractive = on");
+    background.readString("Next:numberCount = 0");
+    background.readString("Init:showChangedSettings = off");
+    background.init();
+  }
+
   Hist mult("charged multiplicity", 100, -0.5, 799.5);
+  Hist n_overlaid("overlaid gamma gamma events", 20, -0.5, 19.5);
 
   // Begin event loop. Generate event. Skip if error.
-  for (int iEvent = 0; iEvent < 100; ++iEvent) {
+  for (int iEvent = 0; iEvent < nevents; ++iEvent) {
     if (!pythia.next()) continue;
 
+    // Add the background events, with their particles after those of the
+    // hard event (Event::operator+= shifts the mother and daughter indices)
+    if (overlay > 0.0) {
+      int n_background = n_overlay_dist(rng);
+      for (int iBackground = 0; iBackground < n_background;) {
+        if (!background.next()) continue;
+        pythia.event += background.event;
+        ++iBackground;
+      }
+      n_overlaid.fill(n_background);
+    }
+
     // Find number of all final charged particles and fill histogram.
     int nCharged = 0;
     for (int i = 0; i < pythia.event.size(); ++i)
@@ -59,6 +142,10 @@ int main() {
   }
   pythia.stat();
   cout << mult;
+  if (overlay > 0.0) {
+    background.stat();
+    cout << n_overlaid;
+  }
 
   // Done.
   return 0;
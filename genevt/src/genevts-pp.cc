@@ -8,24 +8,79 @@
 #include "Pythia8/Pythia.h"
 #include "Pythia8Plugins/HepMC3.h"
 
+#include "genevt-options.hh"
+
 using namespace Pythia8;
 
-int main() {
+const std::string usage = R"(genevts-pp [options]
+
+  --process arg    qcd (default), top, W, Z or H
+  --ecm arg        Centre of mass energy in GeV (default 30000)
+  --pthatmin arg   Minimum pT of the hard process in GeV (default 50)
+  --nevents arg    Number of events (default 100)
+  --output arg     Output HepMC3 file (default derived from the options)
+
+The top, W, Z and H processes produce boosted hadronically decaying objects
+(recoiling against a jet for W, Z and H), with pT above about pthatmin.)";
+
+int main(int argc, char* argv[]) {
+
+  GenOptions options(argc, argv, {"process", "ecm", "pthatmin", "nevents", "output"}, usage);
+  auto process = options.get("process", std::string("qcd"));
+  auto ecm = options.get("ecm", 30000.0);
+  auto pthatmin = options.get("pthatmin", 50.0);
+  auto nevents = options.get("nevents", 100);
+
+  // Default file name follows the existing samples, e.g.,
+  // events-pp-30TeV-50GeV.hepmc3 or events-pp-13TeV-top-500GeV.hepmc3
+  std::string process_label = process == "qcd" ? "" : "-" + process;
+  auto output = options.get("output", "events-pp-" + number_label(ecm / 1000.0) + "TeV" +
+                                      process_label + "-" + number_label(pthatmin) + "GeV.hepmc3");
 
   // Interface for conversion from Pythia8::Event to HepMC
   // event. Specify file where HepMC events will be stored.
-  Pythia8::Pythia8ToHepMC topHepMC("events-pp-30TeV-50GeV.hepmc3");
+  Pythia8::Pythia8ToHepMC topHepMC(output);
 
   // Generator. Process selection. LHC initialization. Histogram.
   Pythia pythia;
-  pythia.readString("Beams:eCM = 30000.");
-  pythia.readString("HardQCD:all = on");
-  pythia.readString("PhaseSpace:pTHatMin = 50.");
+  pythia.readString("Beams:eCM = " + std::to_string(ecm));
+  pythia.readString("PhaseSpace:pTHatMin = " + std::to_string(pthatmin));
+  if (process == "qcd") {
+    pythia.readString("HardQCD:all = on");
+  } else if (process == "top") {
+    // ttbar with both W bosons decaying to quarks
+    pythia.readString("Top:gg2ttbar = on");
+    pythia.readString("Top:qqbar2ttbar = on");
+    pythia.readString("24:onMode = off");
+    pythia.readString("24:onIfAny = 1 2 3 4 5");
+  } else if (process == "W") {
+    pythia.readString("WeakBosonAndParton:qqbar2Wg = on");
+    pythia.readString("WeakBosonAndParton:qg2Wq = on");
+    pythia.readString("24:onMode = off");
+    pythia.readString("24:onIfAny = 1 2 3 4 5");
+  } else if (process == "Z") {
+    // Pure Z (no gamma*) decaying to quarks
+    pythia.readString("WeakBosonAndParton:qqbar2gmZg = on");
+    pythia.readString("WeakBosonAndParton:qg2gmZq = on");
+    pythia.readString("WeakZ0:gmZmode = 2");
+    pythia.readString("23:onMode = off");
+    pythia.readString("23:onIfAny = 1 2 3 4 5");
+  } else if (process == "H") {
+    // H + jet with full top mass dependence in the loop, H -> bb
+    pythia.readString("HiggsSM:gg2Hg(l:t) = on");
+    pythia.readString("HiggsSM:qg2Hq(l:t) = on");
+    pythia.readString("HiggsSM:qqbar2Hg(l:t) = on");
+    pythia.readString("25:onMode = off");
+    pythia.readString("25:onIfMatch = 5 -5");
+  } else {
+    std::cerr << "Unknown process: " << process << "\n" << usage << std::endl;
+    return EXIT_FAILURE;
+  }
   pythia.init();
   Hist mult("charged multiplicity", 100, -0.5, 799.5);
 
   // Begin event loop. Generate event. Skip if error.
-  for (int iEvent = 0; iEvent < 100; ++iEvent) {
+  for (int iEvent = 0; iEvent < nevents; ++iEvent) {
     if (!pythia.next()) continue;
 
     // Find number of all final charged particles and fill histogram.
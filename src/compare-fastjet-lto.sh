@@ -0,0 +1,42 @@
+#! /bin/sh
+#
+# Compare fastjet-finder, linked against the system FastJet, with
+# fastjet-finder-lto, linked against FastJet built from source with link
+# time optimisation (configure with -DFASTJET_SOURCE_TARBALL=...)
+#
+# Usage: compare-fastjet-lto.sh BUILD_DIR INPUT...
+# Options for both finders can be set in FINDER_OPTIONS
+
+# Abort on error
+set -e
+
+if [ $# -lt 2 ]; then
+    echo "Usage: $0 BUILD_DIR INPUT..." >&2
+    exit 1
+fi
+build=$1
+shift
+options=${FINDER_OPTIONS:-"-A AntiKt -R 0.4 --ptmin 5 -n 8"}
+
+tmp=$(mktemp -d)
+trap 'rm -rf $tmp' EXIT
+
+echo "input,system_us_per_event,lto_us_per_event,speedup,same_jets"
+for input in "$@"; do
+    # fastjet-finder reads plain HepMC3 files
+    case $input in
+        *.gz) gunzip -c $input > $tmp/input.hepmc3; events=$tmp/input.hepmc3;;
+        *) events=$input;;
+    esac
+    for finder in fastjet-finder fastjet-finder-lto; do
+        $build/$finder $options -d $tmp/$finder.jets $events > $tmp/$finder.out
+    done
+    system=$(sed -n 's/^Lowest time per event \(.*\) us$/\1/p' $tmp/fastjet-finder.out)
+    lto=$(sed -n 's/^Lowest time per event \(.*\) us$/\1/p' $tmp/fastjet-finder-lto.out)
+    if [ -z "$system" ] || [ -z "$lto" ]; then
+        echo "No time per event found for $input" >&2
+        exit 1
+    fi
+    if cmp -s $tmp/fastjet-finder.jets $tmp/fastjet-finder-lto.jets; then same=yes; else same=no; fi
+    echo "$input,$system,$lto,$(awk "BEGIN { printf \"%.3f\", $system / $lto }"),$same"
+done
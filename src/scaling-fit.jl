@@ -0,0 +1,166 @@
+#! /usr/bin/env julia
+#
+# Fit thread scaling results to the Universal Scalability Law (USL) and to
+# Amdahl's law, to summarise a scaling curve with a few numbers that can be
+# compared between code versions and hardware.
+#
+# The USL models the throughput with N threads as
+#
+#   X(N) = λ N / (1 + σ (N - 1) + κ N (N - 1))
+#
+# where σ is the contention (serial fraction) and κ the coherency
+# coefficient. Amdahl's law is the special case κ = 0. For κ > 0 the
+# throughput peaks at N* = sqrt((1 - σ) / κ).
+#
+# Inputs are CSV files with a threads column and either an event_rate
+# column (as output by thread-scan.sh) or one or more time per event
+# columns (e.g., results-v0/threads-julia-pp-30TeV.csv), which are converted
+# to throughputs.
+#
+using ArgParse
+using CSV
+using DataFrames
+using LinearAlgebra
+using Logging
+using Printf
+
+usl(N, λ, σ, κ) = λ * N / (1 + σ * (N - 1) + κ * N * (N - 1))
+
+"""
+Least squares fit of the USL parameters (λ, σ, κ) to throughputs `X` at
+thread counts `N`, with Levenberg-Marquardt. If `amdahl` is true, κ is fixed
+at zero. The initial guess comes from the linearised USL,
+N/C(N) - 1 = σ (N - 1) + κ N (N - 1), with C(N) = X(N) / λ.
+"""
+function fit_usl(N::Vector{Float64}, X::Vector{Float64}; amdahl = false, iterations = 200)
+    imin = argmin(N)
+    λ = X[imin] / N[imin]
+
+    # Linearised initial guess for σ and κ
+    y = N ./ (X ./ λ) .- 1
+    A = amdahl ? reshape(N .- 1, :, 1) : hcat(N .- 1, N .* (N .- 1))
+    coeffs = A \ y
+    σ = max(coeffs[1], 0.0)
+    κ = amdahl ? 0.0 : max(coeffs[2], 0.0)
+
+    params = [λ, σ, κ]
+    nfree = amdahl ? 2 : 3
+    sse(p) = sum((X .- usl.(N, p[1], p[2], p[3])) .^ 2)
+    current = sse(params)
+    μ = 1.0e-3
+    for _ in 1:iterations
+        λ, σ, κ = params
+        D = 1 .+ σ .* (N .- 1) .+ κ .* N .* (N .- 1)
+        r = X .- λ .* N ./ D
+        J = hcat(N ./ D, -λ .* N .* (N .- 1) ./ D .^ 2, -λ .* N .^ 2 .* (N .- 1) ./ D .^ 2)
+        J = J[:, 1:nfree]
+        JtJ = J' * J
+        step = (JtJ + μ * Diagonal(JtJ)) \ (J' * r)
+        trial = copy(params)
+        trial[1:nfree] .+= step
+        trial[2] = max(trial[2], 0.0)
+        trial[3] = max(trial[3], 0.0)
+        new = sse(trial)
+        if new < current
+            converged = (current - new) < 1.0e-12 * current
+            params, current = trial, new
+            μ /= 10
+            converged && break
+        else
+            μ *= 10
+            μ > 1.0e10 && break
+        end
+    end
+
+    ss_tot = sum((X .- sum(X) / length(X)) .^ 2)
+    r2 = ss_tot > 0 ? 1 - current / ss_tot : 1.0
+    (λ = params[1], σ = params[2], κ = params[3], r2 = r2)
+end
+
+"""Thread count and predicted throughput at the USL peak"""
+function usl_peak(fit)
+    if fit.κ > 0 && fit.σ < 1
+        Npeak = sqrt((1 - fit.σ) / fit.κ)
+        return Npeak, usl(Npeak, fit.λ, fit.σ, fit.κ)
+    end
+    # Amdahl: throughput approaches λ/σ asymptotically
+    return Inf, fit.σ > 0 ? fit.λ / fit.σ : Inf
+end
+
+"""Throughput series from a thread scan table, as (name, N, X) tuples"""
+function throughput_series(df::DataFrame, columns)
+    names_lc = lowercase.(names(df))
+    ithreads = findfirst(==("threads"), names_lc)
+    isnothing(ithreads) && error("No threads column found")
+    N = Float64.(df[!, ithreads])
+
+    series = []
+    if isempty(columns)
+        irate = findfirst(==("event_rate"), names_lc)
+        if !isnothing(irate)
+            push!(series, ("event_rate", N, Float64.(df[!, irate])))
+            return series
+        end
+        columns = [n for (i, n) in enumerate(names(df)) if i != ithreads]
+    end
+    for column in columns
+        values = Float64.(df[!, column])
+        if lowercase(column) == "event_rate"
+            push!(series, (column, N, values))
+        else
+            # Time per event, so throughput is the inverse
+            push!(series, (column, N, 1.0 ./ values))
+        end
+    end
+    series
+end
+
+function parse_command_line(args)
+    s = ArgParseSettings(autofix_names = true)
+    @add_arg_table! s begin
+        "--column"
+        help = "Column(s) to fit (default: event_rate if present, otherwise all time columns)"
+        nargs = '*'
+        default = String[]
+
+        "--output"
+        help = "Write fit results to this CSV file"
+
+        "inputs"
+        help = "Thread scan CSV files"
+        nargs = '+'
+        required = true
+    end
+    return parse_args(args, s; as_symbols = true)
+end
+
+function main()
+    args = parse_command_line(ARGS)
+
+    results = DataFrame(file = String[], series = String[], model = String[],
+                        lambda = Float64[], sigma = Float64[], kappa = Float64[],
+                        r2 = Float64[], peak_threads = Float64[], peak_rate = Float64[])
+    for input in args[:inputs]
+        df = CSV.read(input, DataFrame)
+        for (name, N, X) in throughput_series(df, args[:column])
+            if length(N) < 3
+                @warn "Skipping $input:$name, at least 3 thread counts are needed"
+                continue
+            end
+            for (model, amdahl) in (("USL", false), ("Amdahl", true))
+                fit = fit_usl(N, X; amdahl = amdahl)
+                Npeak, Xpeak = usl_peak(fit)
+                push!(results, (input, name, model, fit.λ, fit.σ, fit.κ, fit.r2, Npeak, Xpeak))
+                @printf("%s %s %-6s λ=%.4g σ=%.4g κ=%.4g R²=%.4f peak N=%.1f X=%.4g\n",
+                        input, name, model, fit.λ, fit.σ, fit.κ, fit.r2, Npeak, Xpeak)
+            end
+        end
+    end
+
+    if !isnothing(args[:output])
+        @info "Writing fit results to $(args[:output])"
+        CSV.write(args[:output], results)
+    end
+end
+
+main()